@@ -0,0 +1,471 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "protocol.h"
+#include "seeded_food.h"
+
+// Food reaches a client as a numbered stream of events, and each side keeps a
+// persistent table of the map's chunks in view. Seeded food (see
+// seeded_food.h) is sent as each chunk's generation and eaten slots when the
+// chunk comes into view, then one event per slot eaten, and the client lays
+// the dots out itself. Dropped food is not seeded; it belongs to the chunk it
+// lies in and travels as spawn and despawn events keyed by food id. Leaving a
+// chunk takes its dropped food with it.
+//
+// Every chunk carries a version the server bumps on any change to it. For
+// every client the server holds the chunks the client will have once it has
+// applied every event so far, each with the version it was diffed at, and
+// each tick it only looks inside the chunks in view whose version moved.
+// Events repeat in every snapshot until the client acknowledges one that
+// carried them, and the client applies each exactly once, in order, so food
+// traffic follows how fast the view changes, not how much is in it or how
+// big the map is.
+//
+// Every FOOD_CHECKSUM_INTERVAL snapshots the server also sends the number of
+// chunks and dropped dots held, and an order-independent hash over them. A
+// client whose table disagrees asks for a resync with MSG_FOOD_RESYNC, and
+// the server starts the stream over with FOOD_RESET followed by everything
+// in view.
+//
+// The server and client each carry a copy of this file; keep them identical.
+
+const uint8_t FOOD_SPAWN = 0;
+const uint8_t FOOD_DESPAWN = 1;
+const uint8_t FOOD_RESET = 2;  // Empties the table, so it applies whatever came before
+const uint8_t CHUNK_STATE = 3;  // A chunk's generation and a flag per slot, set if eaten
+const uint8_t CHUNK_EATEN = 4;
+const uint8_t CHUNK_LEAVE = 5;  // The client may forget the chunk
+const int FOOD_EVENT_BITS = 3;
+const int FOOD_ID_BITS = 32;
+const int COLOR_BITS = 24;
+// The largest event: a CHUNK_STATE for a chunk of MAX_FOOD_PER_CHUNK slots
+const size_t MAX_FOOD_EVENT_BITS = FOOD_EVENT_BITS + FOOD_CHUNK_BITS + 32 + FOOD_SLOT_BITS + MAX_FOOD_PER_CHUNK;
+
+const uint32_t FOOD_CHECKSUM_INTERVAL = 20;
+// A reset costs an event per chunk and dot held. A client whose backlog grows
+// this much longer than that gets a reset instead of the backlog.
+const size_t MAX_PENDING_FOOD_EVENTS = 4096;
+
+struct SnapshotFood {
+    uint32_t id;
+    int32_t x;  // Grid positions
+    int32_t y;
+    uint32_t color;  // 0x00RRGGBB
+};
+
+struct FoodEvent {
+    uint8_t kind;
+    SnapshotFood dot;     // FOOD_SPAWN; only the id for FOOD_DESPAWN
+    uint32_t chunk;       // CHUNK_* events
+    uint32_t generation;  // CHUNK_STATE
+    uint32_t slot;        // CHUNK_EATEN
+    uint32_t slots;       // CHUNK_STATE: slots in the chunk
+    // CHUNK_STATE: on the server, how much of the chunk's eatOrder it covers;
+    // on the client, where its flags start in FoodUpdate::eaten
+    uint32_t eaten;
+};
+
+// The table as of event number through: chunks plus dropped dots held, and
+// the sum of the chunk hashes and of foodHash over the dots
+struct FoodChecksum {
+    uint32_t through;
+    uint32_t count;
+    uint32_t hash;
+};
+
+inline uint32_t foodHash(const SnapshotFood& dot) {
+    uint64_t hash = ((uint64_t)dot.id << 32) ^ ((uint64_t)(uint32_t)dot.x << 16) ^ (uint32_t)dot.y ^
+        ((uint64_t)dot.color << 40);
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return (uint32_t)hash;
+}
+
+// Server side: one chunk of the map
+struct FoodChunk {
+    uint32_t version = 0;  // Bumped on any change below
+    uint32_t generation = 0;
+    std::vector<uint16_t> eatOrder;     // Slots eaten this generation, in the order they went
+    std::vector<SnapshotFood> dropped;  // Sorted by id
+};
+
+// Server side: one client's event stream
+struct FoodSync {
+    struct KnownChunk {
+        uint32_t chunk;
+        uint32_t version;  // The chunk's version when it was last diffed
+        uint32_t generation;
+        uint32_t eaten;    // Prefix of the chunk's eatOrder the client has been sent
+        uint32_t hash;     // The chunk and eaten slot terms of the checksum
+        std::vector<SnapshotFood> dropped;
+    };
+
+    std::vector<KnownChunk> chunks;  // Sorted by chunk
+    uint32_t droppedCount = 0;
+    uint32_t knownHash = 0;
+    std::vector<FoodEvent> events;   // Not acknowledged yet, oldest first
+    uint32_t firstEvent = 1;         // Number of events[0]
+    bool resyncRequested = false;
+    uint32_t resetEvent = 0;         // Number of the last FOOD_RESET, 0 for none
+    uint32_t updatesSinceReset = FOOD_CHECKSUM_INTERVAL;
+
+    uint32_t nextEvent() const {
+        return firstEvent + (uint32_t)events.size();
+    }
+
+    // A client's request for a reset. Honoured only once the last reset is
+    // acknowledged and FOOD_CHECKSUM_INTERVAL updates old, as often as a
+    // checksum can disagree, so a client cannot keep its stream resetting.
+    // Returns whether the request was taken.
+    bool requestResync() {
+        if (resyncRequested || firstEvent <= resetEvent || updatesSinceReset < FOOD_CHECKSUM_INTERVAL) return false;
+        resyncRequested = true;
+        return true;
+    }
+
+    void queueDropped(uint8_t kind, const SnapshotFood& dot) {
+        FoodEvent event = {};
+        event.kind = kind;
+        event.dot = dot;
+        events.push_back(event);
+        if (kind == FOOD_SPAWN) {
+            droppedCount++;
+            knownHash += foodHash(dot);
+        }
+        else {
+            droppedCount--;
+            knownHash -= foodHash(dot);
+        }
+    }
+
+    void queueChunkState(const FoodChunk& chunk, const FoodLayout& layout, KnownChunk& entry) {
+        FoodEvent event = {};
+        event.kind = CHUNK_STATE;
+        event.chunk = entry.chunk;
+        event.generation = chunk.generation;
+        event.slots = layout.slotsIn(entry.chunk);
+        event.eaten = (uint32_t)chunk.eatOrder.size();
+        events.push_back(event);
+
+        knownHash -= entry.hash;
+        entry.generation = chunk.generation;
+        entry.eaten = event.eaten;
+        entry.hash = chunkHash(entry.chunk, entry.generation);
+        for (uint16_t slot : chunk.eatOrder) entry.hash += eatenSlotHash(entry.chunk, entry.generation, slot);
+        knownHash += entry.hash;
+    }
+
+    void queueLeave(const KnownChunk& entry) {
+        FoodEvent event = {};
+        event.kind = CHUNK_LEAVE;
+        event.chunk = entry.chunk;
+        events.push_back(event);
+        knownHash -= entry.hash;
+        for (const SnapshotFood& dot : entry.dropped) knownHash -= foodHash(dot);
+        droppedCount -= (uint32_t)entry.dropped.size();
+    }
+
+    // Queues what changed in a held chunk since it was last diffed
+    void diffChunk(const FoodChunk& chunk, const FoodLayout& layout, KnownChunk& entry) {
+        if (entry.generation != chunk.generation) queueChunkState(chunk, layout, entry);
+        for (; entry.eaten < chunk.eatOrder.size(); entry.eaten++) {
+            FoodEvent event = {};
+            event.kind = CHUNK_EATEN;
+            event.chunk = entry.chunk;
+            event.slot = chunk.eatOrder[entry.eaten];
+            events.push_back(event);
+            uint32_t hash = eatenSlotHash(entry.chunk, entry.generation, event.slot);
+            entry.hash += hash;
+            knownHash += hash;
+        }
+
+        size_t j = 0;
+        for (const SnapshotFood& dot : chunk.dropped) {
+            for (; j < entry.dropped.size() && entry.dropped[j].id < dot.id; j++) queueDropped(FOOD_DESPAWN, entry.dropped[j]);
+            if (j < entry.dropped.size() && entry.dropped[j].id == dot.id) j++;
+            else queueDropped(FOOD_SPAWN, dot);
+        }
+        for (; j < entry.dropped.size(); j++) queueDropped(FOOD_DESPAWN, entry.dropped[j]);
+        entry.dropped = chunk.dropped;
+        entry.version = chunk.version;
+    }
+
+    // Queues the events that turn the client's chunks into inView (sorted).
+    // Chunks coming into view are queued nearest to (originX, originY) first.
+    void update(const std::vector<uint32_t>& inView, const std::vector<FoodChunk>& world, const FoodLayout& layout,
+        int32_t originX, int32_t originY) {
+        if (updatesSinceReset < FOOD_CHECKSUM_INTERVAL) updatesSinceReset++;
+        if (resyncRequested || events.size() > MAX_PENDING_FOOD_EVENTS + chunks.size() + droppedCount) {
+            firstEvent = nextEvent();
+            events.clear();
+            FoodEvent reset = {};
+            reset.kind = FOOD_RESET;
+            events.push_back(reset);
+            resetEvent = firstEvent;
+            updatesSinceReset = 0;
+            chunks.clear();
+            droppedCount = 0;
+            knownHash = 0;
+            resyncRequested = false;
+        }
+
+        static thread_local std::vector<KnownChunk> held;
+        static thread_local std::vector<std::pair<int64_t, size_t>> entering;
+        held.clear();
+        entering.clear();
+        size_t k = 0;
+        for (uint32_t chunk : inView) {
+            for (; k < chunks.size() && chunks[k].chunk < chunk; k++) queueLeave(chunks[k]);
+            if (k < chunks.size() && chunks[k].chunk == chunk) {
+                held.push_back(std::move(chunks[k++]));
+                if (held.back().version != world[chunk].version) diffChunk(world[chunk], layout, held.back());
+                continue;
+            }
+
+            int32_t minX, minY, maxX, maxY;
+            layout.bounds(chunk, minX, minY, maxX, maxY);
+            int64_t dx = (int64_t)(minX + maxX) * FOOD_GRID_PER_UNIT / 2 - originX;
+            int64_t dy = (int64_t)(minY + maxY) * FOOD_GRID_PER_UNIT / 2 - originY;
+            entering.push_back({ dx * dx + dy * dy, held.size() });
+            held.push_back(KnownChunk());
+            held.back().chunk = chunk;
+        }
+        for (; k < chunks.size(); k++) queueLeave(chunks[k]);
+
+        std::sort(entering.begin(), entering.end());
+        for (const auto& enter : entering) {
+            KnownChunk& entry = held[enter.second];
+            const FoodChunk& chunk = world[entry.chunk];
+            entry.hash = 0;
+            queueChunkState(chunk, layout, entry);
+            for (const SnapshotFood& dot : chunk.dropped) queueDropped(FOOD_SPAWN, dot);
+            entry.dropped = chunk.dropped;
+            entry.version = chunk.version;
+        }
+        chunks.swap(held);
+    }
+
+    // The client has applied every event numbered below through
+    void acknowledge(uint32_t through) {
+        if (through <= firstEvent || through > nextEvent()) return;
+        events.erase(events.begin(), events.begin() + (through - firstEvent));
+        firstEvent = through;
+    }
+
+    FoodChecksum checksum() const {
+        return { nextEvent() - 1, (uint32_t)chunks.size() + droppedCount, knownHash };
+    }
+};
+
+// What one snapshot carried of the stream, as the client decodes it
+struct FoodUpdate {
+    uint32_t first = 0;  // Number of events[0]
+    std::vector<FoodEvent> events;
+    std::vector<uint8_t> eaten;  // The CHUNK_STATE flags, back to back
+    bool hasChecksum = false;
+    FoodChecksum checksum = {};
+
+    void clear() {
+        first = 0;
+        events.clear();
+        eaten.clear();
+        hasChecksum = false;
+    }
+};
+
+// Client side: the food it holds
+struct FoodTable {
+    struct Chunk {
+        uint32_t generation = 0;
+        std::vector<SeededDot> dots;  // Laid out from the seed, eaten ones included
+        std::vector<uint8_t> eaten;   // One flag per slot
+        uint32_t hash = 0;
+    };
+
+    FoodLayout layout;  // From the welcome message
+    std::unordered_map<uint32_t, Chunk> chunks;
+    std::unordered_map<uint32_t, SnapshotFood> dots;  // Dropped food in any of the chunks
+    uint32_t applied = 0;  // Number of the last event applied
+    uint32_t hash = 0;
+
+    void clear() {
+        chunks.clear();
+        dots.clear();
+        applied = 0;
+        hash = 0;
+    }
+
+    // Applies the update's events, skipping any already applied. Returns
+    // false, applying nothing, if an event before them is missing.
+    bool apply(const FoodUpdate& update) {
+        const std::vector<FoodEvent>& events = update.events;
+        if (events.empty()) return true;
+        if (update.first > applied + 1 && events[0].kind != FOOD_RESET) return false;
+
+        for (size_t i = 0; i < events.size(); i++) {
+            uint32_t number = update.first + (uint32_t)i;
+            if (number <= applied) continue;
+            const FoodEvent& event = events[i];
+            if (event.kind == FOOD_RESET) {
+                chunks.clear();
+                dots.clear();
+                hash = 0;
+            }
+            else if (event.kind == CHUNK_STATE) {
+                Chunk& chunk = chunks[event.chunk];
+                hash -= chunk.hash;
+                if (chunk.dots.empty() || chunk.generation != event.generation) {
+                    chunk.dots.clear();
+                    if (event.chunk < layout.chunkCount()) {
+                        uint32_t slots = std::min(event.slots, layout.slotsIn(event.chunk));
+                        for (uint32_t slot = 0; slot < slots; slot++) {
+                            chunk.dots.push_back(layout.dot(event.chunk, event.generation, slot));
+                        }
+                    }
+                }
+                chunk.generation = event.generation;
+                chunk.eaten.assign(update.eaten.begin() + event.eaten,
+                    update.eaten.begin() + event.eaten + event.slots);
+                chunk.hash = chunkHash(event.chunk, event.generation);
+                for (uint32_t slot = 0; slot < event.slots; slot++) {
+                    if (chunk.eaten[slot]) chunk.hash += eatenSlotHash(event.chunk, event.generation, slot);
+                }
+                hash += chunk.hash;
+            }
+            else if (event.kind == CHUNK_EATEN) {
+                auto it = chunks.find(event.chunk);
+                if (it != chunks.end() && event.slot < it->second.eaten.size() && !it->second.eaten[event.slot]) {
+                    Chunk& chunk = it->second;
+                    chunk.eaten[event.slot] = 1;
+                    uint32_t slotHash = eatenSlotHash(event.chunk, chunk.generation, event.slot);
+                    chunk.hash += slotHash;
+                    hash += slotHash;
+                }
+            }
+            else if (event.kind == CHUNK_LEAVE) {
+                auto it = chunks.find(event.chunk);
+                if (it != chunks.end()) {
+                    hash -= it->second.hash;
+                    chunks.erase(it);
+                }
+                for (auto dot = dots.begin(); dot != dots.end();) {
+                    if (layout.chunkAtGrid(dot->second.x, dot->second.y) != event.chunk) {
+                        ++dot;
+                        continue;
+                    }
+                    hash -= foodHash(dot->second);
+                    dot = dots.erase(dot);
+                }
+            }
+            else if (event.kind == FOOD_SPAWN) {
+                auto inserted = dots.insert({ event.dot.id, event.dot });
+                if (!inserted.second) {
+                    hash -= foodHash(inserted.first->second);
+                    inserted.first->second = event.dot;
+                }
+                hash += foodHash(event.dot);
+            }
+            else {
+                auto it = dots.find(event.dot.id);
+                if (it != dots.end()) {
+                    hash -= foodHash(it->second);
+                    dots.erase(it);
+                }
+            }
+            applied = number;
+        }
+        return true;
+    }
+
+    // False only when the checksum covers exactly what was applied and disagrees
+    bool matches(const FoodChecksum& checksum) const {
+        if (checksum.through != applied) return true;
+        return checksum.count == dots.size() + chunks.size() && checksum.hash == hash;
+    }
+};
+
+// Whether the event can still be written: a dropped dot's position must fit
+// as an offset from the origin, which one queued before a long jump may not,
+// and a chunk state needs the chunk to be on the generation it was queued for
+inline bool foodEventFits(const FoodEvent& event, const std::vector<FoodChunk>& world, int32_t originX,
+    int32_t originY) {
+    if (event.kind == CHUNK_STATE) {
+        const FoodChunk& chunk = world[event.chunk];
+        return chunk.generation == event.generation && chunk.eatOrder.size() >= event.eaten;
+    }
+    if (event.kind != FOOD_SPAWN) return true;
+    int64_t dx = (int64_t)event.dot.x - originX;
+    int64_t dy = (int64_t)event.dot.y - originY;
+    return dx >= -POSITION_RANGE && dx <= POSITION_RANGE && dy >= -POSITION_RANGE && dy <= POSITION_RANGE;
+}
+
+// Bits writeFoodEvent writes for the event
+inline size_t foodEventBits(const FoodEvent& event) {
+    switch (event.kind) {
+    case FOOD_SPAWN: return FOOD_EVENT_BITS + FOOD_ID_BITS + 2 * POSITION_BITS + COLOR_BITS;
+    case FOOD_DESPAWN: return FOOD_EVENT_BITS + FOOD_ID_BITS;
+    case CHUNK_STATE: return FOOD_EVENT_BITS + FOOD_CHUNK_BITS + 32 + FOOD_SLOT_BITS + event.slots;
+    case CHUNK_EATEN: return FOOD_EVENT_BITS + FOOD_CHUNK_BITS + FOOD_SLOT_BITS;
+    case CHUNK_LEAVE: return FOOD_EVENT_BITS + FOOD_CHUNK_BITS;
+    default: return FOOD_EVENT_BITS;
+    }
+}
+
+// Writes a chunk state's flags from the first event.eaten entries of the
+// chunk's eatOrder, so it must still fit (see foodEventFits)
+inline void writeFoodEvent(BitWriter& bits, const FoodEvent& event, const std::vector<FoodChunk>& world,
+    int32_t originX, int32_t originY) {
+    bits.write(event.kind, FOOD_EVENT_BITS);
+    if (event.kind == FOOD_RESET) return;
+    if (event.kind >= CHUNK_STATE) {
+        bits.write(event.chunk, FOOD_CHUNK_BITS);
+        if (event.kind == CHUNK_EATEN) bits.write(event.slot, FOOD_SLOT_BITS);
+        if (event.kind != CHUNK_STATE) return;
+        bits.write(event.generation, 32);
+        bits.write(event.slots, FOOD_SLOT_BITS);
+        static thread_local std::vector<uint8_t> flags;
+        flags.assign(event.slots, 0);
+        const std::vector<uint16_t>& eatOrder = world[event.chunk].eatOrder;
+        for (uint32_t i = 0; i < event.eaten; i++) {
+            if (eatOrder[i] < event.slots) flags[eatOrder[i]] = 1;
+        }
+        for (uint8_t flag : flags) bits.write(flag, 1);
+        return;
+    }
+    bits.write(event.dot.id, FOOD_ID_BITS);
+    if (event.kind == FOOD_DESPAWN) return;
+    bits.writeSigned(event.dot.x - originX, POSITION_BITS);
+    bits.writeSigned(event.dot.y - originY, POSITION_BITS);
+    bits.write(event.dot.color, COLOR_BITS);
+}
+
+// CHUNK_STATE flags are appended to eaten
+inline bool readFoodEvent(BitReader& bits, FoodEvent& event, std::vector<uint8_t>& eaten, int32_t originX,
+    int32_t originY) {
+    event = FoodEvent();
+    event.kind = (uint8_t)bits.read(FOOD_EVENT_BITS);
+    if (event.kind >= CHUNK_STATE) {
+        event.chunk = bits.read(FOOD_CHUNK_BITS);
+        if (event.kind == CHUNK_EATEN) event.slot = bits.read(FOOD_SLOT_BITS);
+        if (event.kind == CHUNK_STATE) {
+            event.generation = bits.read(32);
+            event.slots = bits.read(FOOD_SLOT_BITS);
+            event.eaten = (uint32_t)eaten.size();
+            for (uint32_t i = 0; i < event.slots && !bits.failed(); i++) eaten.push_back((uint8_t)bits.read(1));
+        }
+        return !bits.failed() && event.kind <= CHUNK_LEAVE;
+    }
+    if (event.kind != FOOD_RESET) event.dot.id = bits.read(FOOD_ID_BITS);
+    if (event.kind == FOOD_SPAWN) {
+        event.dot.x = originX + bits.readSigned(POSITION_BITS);
+        event.dot.y = originY + bits.readSigned(POSITION_BITS);
+        event.dot.color = bits.read(COLOR_BITS);
+    }
+    return !bits.failed();
+}
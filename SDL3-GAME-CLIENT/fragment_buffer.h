@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "protocol.h"
+
+// Puts MSG_FRAGMENT pieces back together. A few messages can be in flight at
+// once; one still missing pieces TIMEOUT_MS after its first piece arrived is
+// dropped, since a newer snapshot will have replaced it by then anyway.
+struct FragmentBuffer {
+    static const int SLOTS = 4;
+    static const uint64_t TIMEOUT_MS = 250;
+
+    struct Assembly {
+        bool active = false;
+        uint32_t messageId = 0;
+        uint8_t count = 0;
+        uint8_t received = 0;
+        uint32_t receivedMask = 0;
+        size_t length = 0;  // Known once the last piece is in
+        uint64_t startedMs = 0;
+        std::vector<uint8_t> data = std::vector<uint8_t>(MAX_PACKET_SIZE);
+    };
+
+    Assembly slots[SLOTS];
+
+    void expire(uint64_t nowMs) {
+        for (Assembly& assembly : slots) {
+            if (assembly.active && nowMs - assembly.startedMs > TIMEOUT_MS) assembly.active = false;
+        }
+    }
+
+    // Adds one piece. When it completes a message, points message at the
+    // reassembled datagram and returns its length; otherwise returns 0.
+    size_t add(const FragmentHeader& header, const uint8_t* bytes, size_t length, uint64_t nowMs,
+        const uint8_t*& message) {
+        expire(nowMs);
+
+        Assembly& assembly = slots[header.messageId % SLOTS];
+        if (assembly.active && assembly.messageId != header.messageId) {
+            if (header.messageId < assembly.messageId) return 0;  // Older than what we are building
+            assembly.active = false;
+        }
+        if (!assembly.active) {
+            assembly.active = true;
+            assembly.messageId = header.messageId;
+            assembly.count = header.count;
+            assembly.received = 0;
+            assembly.receivedMask = 0;
+            assembly.length = 0;
+            assembly.startedMs = nowMs;
+        }
+
+        uint32_t bit = 1u << header.index;
+        if (header.count != assembly.count || (assembly.receivedMask & bit)) return 0;
+        memcpy(assembly.data.data() + header.offset, bytes, length);
+        assembly.receivedMask |= bit;
+        assembly.received++;
+        if (header.index == header.count - 1) assembly.length = header.offset + length;
+
+        if (assembly.received < assembly.count) return 0;
+        assembly.active = false;
+        message = assembly.data.data();
+        return assembly.length;
+    }
+};
@@ -6,14 +6,15 @@
 #include <sstream>
 #include <cmath>
 #include <algorithm>
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
 #include "network_common.h"
+#include "protocol.h"
+#include "snapshot_delta.h"
+#include "food_sync.h"
+#include "fragment_buffer.h"
 #include "server_browser.h"
 
-#pragma comment(lib, "ws2_32.lib")
 #pragma comment(lib, "SDL3.lib")
 #pragma comment(lib, "SDL3_ttf.lib")
 
@@ -26,6 +27,9 @@ const int MINIMAP_BORDER = 3;
 
 const float WORLD_TO_PIXEL_SCALE = 2.0f;
 
+// Target frame time, about 60 frames per second
+const Uint64 FRAME_MS = 16;
+
 int MAP_WIDTH = 200;
 int MAP_HEIGHT = 200;
 
@@ -36,25 +40,14 @@ enum GameState {
     STATE_PLAYING
 };
 
-struct FoodDot {
-    int id;
-    float x;
-    float y;
-    uint8_t r, g, b;
-};
-
 struct Cell {
     float x;
     float y;
     float size;
-    std::string name;
-    uint8_t colorR;
-    uint8_t colorG;
-    uint8_t colorB;
 };
 
 struct Player {
-    std::string uuid;
+    uint32_t id;
     std::string name;
     std::vector<Cell> cells;
     uint8_t colorR;
@@ -82,14 +75,23 @@ struct AppState {
     bool editingName = false;
     std::string errorMessage = "";
 
-    std::string assignedUUID;
+    uint64_t session = 0;  // 0 until the server welcomes us
+    uint32_t myPlayerId = 0;
     std::vector<Cell> myCells;
     uint8_t myColorR = 100;
     uint8_t myColorG = 100;
     uint8_t myColorB = 255;
-    std::map<std::string, Player> otherPlayers;
-    std::vector<FoodDot> food;
+    std::map<uint32_t, Player> otherPlayers;  // Only players in view
+    std::vector<std::pair<std::string, float>> leaderboard;  // Biggest players anywhere on the map
+    FoodTable food;  // Kept up to date by the server's food events
+    FoodUpdate foodUpdate;
+    std::vector<SnapshotState> snapshots = std::vector<SnapshotState>(SNAPSHOT_HISTORY);  // Rebuilt states, at sequence % SNAPSHOT_HISTORY
+    uint32_t lastSnapshot = 0;  // Sequence of the snapshot on screen
+    std::vector<EntityInfo> entities;  // Indexed by the entity ids snapshots use
+    std::vector<EntityInfo> announced;
+    FragmentBuffer fragments;  // Snapshots bigger than the server's MTU
     bool running = true;
+    InputCommands inputs;  // Newest input commands sent, repeated in every MSG_INPUT
     Uint64 lastInputTime = 0;
     const Uint64 INPUT_COOLDOWN = 50;
 
@@ -270,159 +272,216 @@ void drawConnecting(AppState* state) {
     drawTextCentered(state, state->fontLarge, "Connecting...", WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2, white);
 }
 
-void sendCommand(AppState* state, const std::string& command) {
-    std::string message = state->assignedUUID + ":" + state->playerName + ":" + command;
-    sendto(state->clientSocket, message.c_str(), message.length(), 0,
+void sendPacket(AppState* state, const uint8_t* packet, size_t length) {
+    if (length == 0) return;
+    sendto(state->clientSocket, (const char*)packet, (int)length, 0,
         (sockaddr*)&state->serverAddr, sizeof(state->serverAddr));
 }
 
+// Sends a new input command along with the few before it
+void sendInput(AppState* state, uint8_t flags) {
+    InputCommands& inputs = state->inputs;
+    for (int i = INPUT_REDUNDANCY - 1; i > 0; i--) inputs.flags[i] = inputs.flags[i - 1];
+    inputs.flags[0] = flags;
+    inputs.sequence++;
+
+    uint8_t packet[32];
+    ByteWriter writer(packet, sizeof(packet));
+    sendPacket(state, packet, encodeInput(writer, state->session, inputs));
+}
+
 void sendSplit(AppState* state) {
-    std::string message = state->assignedUUID + ":" + state->playerName + ":SPLIT";
-    sendto(state->clientSocket, message.c_str(), message.length(), 0,
-        (sockaddr*)&state->serverAddr, sizeof(state->serverAddr));
+    sendInput(state, INPUT_SPLIT);
 }
 
 void sendMerge(AppState* state) {
-    std::string message = state->assignedUUID + ":" + state->playerName + ":MERGE";
-    sendto(state->clientSocket, message.c_str(), message.length(), 0,
-        (sockaddr*)&state->serverAddr, sizeof(state->serverAddr));
+    sendInput(state, INPUT_MERGE);
 }
 
 void sendPong(AppState* state) {
-    std::string message = state->assignedUUID + ":" + state->playerName + ":PONG";
-    sendto(state->clientSocket, message.c_str(), message.length(), 0,
-        (sockaddr*)&state->serverAddr, sizeof(state->serverAddr));
+    uint8_t packet[32];
+    ByteWriter writer(packet, sizeof(packet));
+    sendPacket(state, packet, encodeSessionMessage(writer, MSG_PONG, state->session));
 }
 
-void sendAck(AppState* state) {
-    std::string message = state->assignedUUID + ":" + state->playerName + ":ACK";
-    sendto(state->clientSocket, message.c_str(), message.length(), 0,
-        (sockaddr*)&state->serverAddr, sizeof(state->serverAddr));
+// The server sends whatever falls inside the window at the current zoom
+Viewport currentViewport() {
+    Viewport viewport;
+    viewport.width = (uint16_t)std::min(std::max(WINDOW_WIDTH, 0), 65535);
+    viewport.height = (uint16_t)std::min(std::max(WINDOW_HEIGHT, 0), 65535);
+    viewport.zoom = WORLD_TO_PIXEL_SCALE;
+    return viewport;
 }
 
-void parseServerResponse(AppState* state, const std::string& response) {
-    if (response == "PING") {
-        sendPong(state);
-        return;
-    }
+void sendViewport(AppState* state) {
+    uint8_t packet[32];
+    ByteWriter writer(packet, sizeof(packet));
+    sendPacket(state, packet, encodeViewport(writer, state->session, currentViewport()));
+}
 
-    std::stringstream ss(response);
-    std::string token;
-    bool receivedData = false;
+void sendAck(AppState* state, uint32_t sequence) {
+    uint8_t packet[32];
+    ByteWriter writer(packet, sizeof(packet));
+    sendPacket(state, packet, encodeAck(writer, state->session, sequence));
+}
 
-    while (std::getline(ss, token, '|')) {
-        if (token.substr(0, 5) == "UUID:") {
-            state->assignedUUID = token.substr(5);
-        }
-        else if (token.substr(0, 4) == "MAP:") {
-            std::string mapData = token.substr(4);
-            size_t commaPos = mapData.find(',');
-            if (commaPos != std::string::npos) {
-                MAP_WIDTH = std::stoi(mapData.substr(0, commaPos));
-                MAP_HEIGHT = std::stoi(mapData.substr(commaPos + 1));
-            }
-        }
-        else if (token.substr(0, 6) == "COLOR:") {
-            std::string colorData = token.substr(6);
-            std::stringstream colorStream(colorData);
-            std::string rStr, gStr, bStr;
-            std::getline(colorStream, rStr, ',');
-            std::getline(colorStream, gStr, ',');
-            std::getline(colorStream, bStr, ',');
-            state->myColorR = std::stoi(rStr);
-            state->myColorG = std::stoi(gStr);
-            state->myColorB = std::stoi(bStr);
+void sendFoodResync(AppState* state) {
+    uint8_t packet[32];
+    ByteWriter writer(packet, sizeof(packet));
+    sendPacket(state, packet, encodeSessionMessage(writer, MSG_FOOD_RESYNC, state->session));
+}
+
+const EntityInfo* findEntity(const AppState* state, uint16_t id) {
+    if (id >= state->entities.size() || state->entities[id].id != id) return nullptr;
+    return &state->entities[id];
+}
+
+// Copies a rebuilt snapshot into what the renderer draws
+void applySnapshot(AppState* state, const SnapshotState& snapshot) {
+    state->myCells.clear();
+    state->otherPlayers.clear();
+    for (const SnapshotPlayer& entry : snapshot.players) {
+        const EntityInfo* info = findEntity(state, entry.id);
+        if (!info) continue;
+
+        Player* other = nullptr;
+        if (info->playerId != state->myPlayerId) {
+            other = &state->otherPlayers[info->playerId];
+            other->id = info->playerId;
+            other->name = info->name;
+            other->colorR = info->r;
+            other->colorG = info->g;
+            other->colorB = info->b;
         }
-        else if (token.substr(0, 8) == "PLAYERS:") {
-            state->myCells.clear();
-            state->otherPlayers.clear();
-
-            std::string playersData = token.substr(8);
-            if (!playersData.empty()) {
-                std::stringstream playerStream(playersData);
-                std::string playerToken;
-                while (std::getline(playerStream, playerToken, ';')) {
-                    if (playerToken.empty()) continue;
-                    std::stringstream playerInfo(playerToken);
-                    std::string uuid, name, xStr, yStr, sizeStr, rStr, gStr, bStr;
-                    std::getline(playerInfo, uuid, ',');
-                    std::getline(playerInfo, name, ',');
-                    std::getline(playerInfo, xStr, ',');
-                    std::getline(playerInfo, yStr, ',');
-                    std::getline(playerInfo, sizeStr, ',');
-                    std::getline(playerInfo, rStr, ',');
-                    std::getline(playerInfo, gStr, ',');
-                    std::getline(playerInfo, bStr, ',');
-
-                    Cell cell;
-                    cell.x = std::stof(xStr);
-                    cell.y = std::stof(yStr);
-                    cell.size = std::stof(sizeStr);
-                    cell.name = name;
-                    cell.colorR = std::stoi(rStr);
-                    cell.colorG = std::stoi(gStr);
-                    cell.colorB = std::stoi(bStr);
-
-                    if (uuid == state->assignedUUID) {
-                        state->myCells.push_back(cell);
-                    }
-                    else {
-                        if (state->otherPlayers.find(uuid) == state->otherPlayers.end()) {
-                            Player p;
-                            p.uuid = uuid;
-                            p.name = name;
-                            p.colorR = cell.colorR;
-                            p.colorG = cell.colorG;
-                            p.colorB = cell.colorB;
-                            state->otherPlayers[uuid] = p;
-                        }
-                        state->otherPlayers[uuid].cells.push_back(cell);
-                    }
-                }
-            }
-            receivedData = true;
+
+        const SnapshotCell* cells = snapshot.cellsOf(entry);
+        for (int c = 0; c < entry.cellCount; c++) {
+            Cell cell = { dequantizePosition(cells[c].x), dequantizePosition(cells[c].y),
+                dequantizeSize(cells[c].size) };
+            if (other) other->cells.push_back(cell);
+            else state->myCells.push_back(cell);
         }
-        else if (token.substr(0, 5) == "FOOD:") {
-            state->food.clear();
-            std::string foodData = token.substr(5);
-            if (!foodData.empty()) {
-                std::stringstream foodStream(foodData);
-                std::string foodToken;
-                while (std::getline(foodStream, foodToken, ';')) {
-                    if (foodToken.empty()) continue;
-                    std::stringstream foodInfo(foodToken);
-                    std::string idStr, xStr, yStr, rStr, gStr, bStr;
-                    std::getline(foodInfo, idStr, ',');
-                    std::getline(foodInfo, xStr, ',');
-                    std::getline(foodInfo, yStr, ',');
-                    std::getline(foodInfo, rStr, ',');
-                    std::getline(foodInfo, gStr, ',');
-                    std::getline(foodInfo, bStr, ',');
-                    FoodDot f;
-                    f.id = std::stoi(idStr);
-                    f.x = std::stof(xStr);
-                    f.y = std::stof(yStr);
-                    f.r = std::stoi(rStr);
-                    f.g = std::stoi(gStr);
-                    f.b = std::stoi(bStr);
-                    state->food.push_back(f);
-                }
-            }
-            receivedData = true;
+    }
+
+    state->leaderboard.clear();
+    for (const SnapshotLeader& entry : snapshot.leaderboard) {
+        const EntityInfo* info = findEntity(state, entry.id);
+        state->leaderboard.push_back({ info ? info->name : std::string(), entry.totalSize });
+    }
+}
+
+// Rebuilds the snapshot from the baseline it names, applies its food events and
+// acknowledges it, so the server can encode the next one against it.
+// Snapshots whose baseline we no longer hold, or whose food events do not
+// follow on from ours, are dropped without an acknowledgement; the server
+// repeats what we missed.
+void readSnapshot(AppState* state, ByteReader& reader) {
+    uint32_t sequence, baselineSequence;
+    if (!peekSnapshotSequence(reader, sequence, baselineSequence)) return;
+    if (sequence <= state->lastSnapshot) return;  // Arrived after a newer one
+
+    const SnapshotState* baseline = nullptr;
+    if (baselineSequence != 0) {
+        if (sequence - baselineSequence >= SNAPSHOT_HISTORY) return;
+        baseline = &state->snapshots[baselineSequence % SNAPSHOT_HISTORY];
+        if (baseline->header.sequence != baselineSequence) return;
+    }
+
+    SnapshotState& snapshot = state->snapshots[sequence % SNAPSHOT_HISTORY];
+    FoodUpdate& food = state->foodUpdate;
+    if (!decodeSnapshotDelta(reader, baseline, snapshot, state->announced, food) ||
+        !state->food.apply(food)) {
+        snapshot.clear();
+        return;
+    }
+    if (food.hasChecksum && !state->food.matches(food.checksum)) sendFoodResync(state);
+
+    for (const EntityInfo& info : state->announced) {
+        if (info.id >= state->entities.size()) {
+            EntityInfo unknown = {};
+            unknown.id = 0xFFFF;
+            state->entities.resize(info.id + 1, unknown);
         }
+        state->entities[info.id] = info;
     }
 
-    if (receivedData) sendAck(state);
+    state->lastSnapshot = sequence;
+    applySnapshot(state, snapshot);
+    sendAck(state, sequence);
+}
+
+void handleServerMessage(AppState* state, const uint8_t* data, int length) {
+    ByteReader reader(data, length);
+    uint8_t type = readMessageHeader(reader);
+
+    if (type == MSG_PING) {
+        sendPong(state);
+    }
+    else if (type == MSG_WELCOME) {
+        WelcomeMessage welcome;
+        if (!decodeWelcome(reader, welcome)) return;
+        state->session = welcome.session;
+        state->myPlayerId = welcome.playerId;
+        MAP_WIDTH = (int)welcome.mapWidth;
+        MAP_HEIGHT = (int)welcome.mapHeight;
+        state->myColorR = welcome.r;
+        state->myColorG = welcome.g;
+        state->myColorB = welcome.b;
+        // The server starts this session over with a full snapshot
+        for (auto& snapshot : state->snapshots) snapshot.clear();
+        state->lastSnapshot = 0;
+        state->food.clear();
+        state->food.layout.init(welcome.foodSeed, welcome.mapWidth, welcome.mapHeight, welcome.foodChunkSize,
+            welcome.foodPerChunk);
+        state->entities.clear();
+        state->fragments = FragmentBuffer();
+        state->inputs = InputCommands();
+    }
+    else if (type == MSG_SNAPSHOT) {
+        readSnapshot(state, reader);
+    }
+    else if (type == MSG_FRAGMENT) {
+        FragmentHeader fragment;
+        if (!readFragmentHeader(reader, fragment)) return;
+        const uint8_t* message = nullptr;
+        size_t messageLength = state->fragments.add(fragment, data + reader.pos, reader.remaining(),
+            SDL_GetTicks(), message);
+        if (messageLength == 0) return;
+
+        // Only snapshots are ever split
+        ByteReader inner(message, messageLength);
+        if (readMessageHeader(inner) == MSG_SNAPSHOT) readSnapshot(state, inner);
+    }
 }
 
+// Handles every datagram waiting on the socket
 void checkServerMessages(AppState* state) {
-    char buffer[32768];
-    int serverAddrLen = sizeof(state->serverAddr);
-    int recvLen = recvfrom(state->clientSocket, buffer, sizeof(buffer) - 1, 0,
-        (sockaddr*)&state->serverAddr, &serverAddrLen);
-    if (recvLen > 0) {
-        buffer[recvLen] = '\0';
-        parseServerResponse(state, std::string(buffer));
+    static uint8_t buffer[MAX_PACKET_SIZE];
+    while (state->clientSocket != INVALID_SOCKET) {
+        socklen_t serverAddrLen = sizeof(state->serverAddr);
+        int recvLen = recvfrom(state->clientSocket, (char*)buffer, sizeof(buffer), 0,
+            (sockaddr*)&state->serverAddr, &serverAddrLen);
+        if (recvLen == SOCKET_ERROR) {
+            if (socketWouldBlock()) return;
+            continue;
+        }
+        handleServerMessage(state, buffer, recvLen);
+    }
+}
+
+// Sleeps out the rest of the frame. While playing, server messages are
+// handled the moment they arrive, so pings, acks and snapshots do not queue
+// behind rendering.
+void waitForNextFrame(AppState* state, Uint64 frameStart) {
+    while (true) {
+        Uint64 elapsed = SDL_GetTicks() - frameStart;
+        if (elapsed >= FRAME_MS) return;
+        int remaining = (int)(FRAME_MS - elapsed);
+        if (state->gameState != STATE_PLAYING || state->clientSocket == INVALID_SOCKET) {
+            SDL_Delay(remaining);
+            return;
+        }
+        if (waitReadable(state->clientSocket, remaining)) checkServerMessages(state);
     }
 }
 
@@ -430,14 +489,14 @@ void processHeldKeys(AppState* state) {
     Uint64 currentTime = SDL_GetTicks();
     if (currentTime - state->lastInputTime < state->INPUT_COOLDOWN) return;
 
-    std::string command = "";
-    if (state->keyW) command += "DOWN";
-    if (state->keyS) { if (!command.empty()) command += ","; command += "UP"; }
-    if (state->keyA) { if (!command.empty()) command += ","; command += "LEFT"; }
-    if (state->keyD) { if (!command.empty()) command += ","; command += "RIGHT"; }
+    uint8_t flags = 0;
+    if (state->keyW) flags |= INPUT_DOWN;
+    if (state->keyS) flags |= INPUT_UP;
+    if (state->keyA) flags |= INPUT_LEFT;
+    if (state->keyD) flags |= INPUT_RIGHT;
 
-    if (!command.empty()) {
-        sendCommand(state, command);
+    if (flags != 0) {
+        sendInput(state, flags);
         state->lastInputTime = currentTime;
     }
 }
@@ -522,23 +581,36 @@ void drawGrid(AppState* state) {
     }
 }
 
-void drawFood(AppState* state) {
-    for (const auto& f : state->food) {
-        float screenX = worldToScreenX(state, f.x);
-        float screenY = worldToScreenY(state, f.y);
-        float pixelSize = worldToPixelSize(5.0f);
+void drawFoodDot(AppState* state, int32_t x, int32_t y, uint32_t color) {
+    float screenX = worldToScreenX(state, dequantizePosition(x));
+    float screenY = worldToScreenY(state, dequantizePosition(y));
+    float pixelSize = worldToPixelSize(5.0f);
 
-        if (screenX < -pixelSize || screenX > WINDOW_WIDTH + pixelSize ||
-            screenY < -pixelSize || screenY > WINDOW_HEIGHT + pixelSize) continue;
+    if (screenX < -pixelSize || screenX > WINDOW_WIDTH + pixelSize ||
+        screenY < -pixelSize || screenY > WINDOW_HEIGHT + pixelSize) return;
+
+    SDL_SetRenderDrawColor(state->renderer, (uint8_t)(color >> 16), (uint8_t)(color >> 8), (uint8_t)color, 255);
 
-        SDL_SetRenderDrawColor(state->renderer, f.r, f.g, f.b, 255);
+    int radius = (int)pixelSize;
+    for (int y = -radius; y <= radius; y++) {
+        int width = (int)sqrt(radius * radius - y * y);
+        SDL_RenderLine(state->renderer, screenX - width, screenY + y, screenX + width, screenY + y);
+    }
+}
 
-        int radius = (int)pixelSize;
-        for (int y = -radius; y <= radius; y++) {
-            int width = (int)sqrt(radius * radius - y * y);
-            SDL_RenderLine(state->renderer, screenX - width, screenY + y, screenX + width, screenY + y);
+// The seeded chunks' uneaten dots, then the dropped food
+void drawFood(AppState* state) {
+    for (const auto& entry : state->food.chunks) {
+        const FoodTable::Chunk& chunk = entry.second;
+        for (size_t slot = 0; slot < chunk.dots.size(); slot++) {
+            if (chunk.eaten[slot]) continue;
+            drawFoodDot(state, chunk.dots[slot].x, chunk.dots[slot].y, chunk.dots[slot].color);
         }
     }
+    for (const auto& entry : state->food.dots) {
+        const SnapshotFood& f = entry.second;
+        drawFoodDot(state, f.x, f.y, f.color);
+    }
 }
 
 void fillCircle(SDL_Renderer* renderer, float cx, float cy, float radius) {
@@ -549,7 +621,7 @@ void fillCircle(SDL_Renderer* renderer, float cx, float cy, float radius) {
     }
 }
 
-void drawCell(AppState* state, const Cell& cell, bool isPlayer) {
+void drawCell(AppState* state, const Cell& cell, const std::string& name, uint8_t r, uint8_t g, uint8_t b) {
     float screenX = worldToScreenX(state, cell.x);
     float screenY = worldToScreenY(state, cell.y);
     float pixelSize = worldToPixelSize(cell.size);
@@ -560,31 +632,15 @@ void drawCell(AppState* state, const Cell& cell, bool isPlayer) {
     SDL_SetRenderDrawColor(state->renderer, 0, 0, 0, 100);
     fillCircle(state->renderer, screenX + 3, screenY + 3, pixelSize);
 
-    SDL_SetRenderDrawColor(state->renderer, cell.colorR, cell.colorG, cell.colorB, 255);
+    SDL_SetRenderDrawColor(state->renderer, r, g, b, 255);
     fillCircle(state->renderer, screenX, screenY, pixelSize);
 
-    drawTextInCircle(state, cell.name, screenX, screenY, pixelSize * 1.8f);
+    drawTextInCircle(state, name, screenX, screenY, pixelSize * 1.8f);
 }
 
 void drawLeaderboard(AppState* state) {
-    std::vector<std::pair<std::string, float>> leaderboard;
-
-    float myTotalSize = 0;
-    for (const auto& cell : state->myCells) {
-        myTotalSize += cell.size;
-    }
-    leaderboard.push_back({ state->playerName, myTotalSize });
-
-    for (const auto& pair : state->otherPlayers) {
-        float totalSize = 0;
-        for (const auto& cell : pair.second.cells) {
-            totalSize += cell.size;
-        }
-        leaderboard.push_back({ pair.second.name, totalSize });
-    }
-
-    std::sort(leaderboard.begin(), leaderboard.end(),
-        [](const auto& a, const auto& b) { return a.second > b.second; });
+    // The server sends it already sorted, biggest first
+    const std::vector<std::pair<std::string, float>>& leaderboard = state->leaderboard;
 
     float lbX = WINDOW_WIDTH - 220;
     float lbY = 10;
@@ -659,7 +715,7 @@ void drawCellCount(AppState* state) {
 
 bool connectToServer(AppState* state) {
     if (state->clientSocket != INVALID_SOCKET) {
-        closesocket(state->clientSocket);
+        closeSocket(state->clientSocket);
     }
 
     state->clientSocket = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
@@ -677,84 +733,71 @@ bool connectToServer(AppState* state) {
 
     if (inet_pton(AF_INET6, state->serverIP.c_str(), &state->serverAddr.sin6_addr) != 1) {
         state->errorMessage = "Invalid server address";
-        closesocket(state->clientSocket);
+        closeSocket(state->clientSocket);
         state->clientSocket = INVALID_SOCKET;
         return false;
     }
 
-    std::string initMessage = "NONE:" + state->playerName + ":INIT";
-    sendto(state->clientSocket, initMessage.c_str(), initMessage.length(), 0,
-        (sockaddr*)&state->serverAddr, sizeof(state->serverAddr));
+    uint8_t connectPacket[MESSAGE_HEADER_SIZE + 2 * (MAX_STRING_LENGTH + 1) + 8];
+    ByteWriter connectWriter(connectPacket, sizeof(connectPacket));
+    size_t connectLength = encodeConnect(connectWriter, state->playerName, "", currentViewport());
+    state->session = 0;
+    sendPacket(state, connectPacket, connectLength);
 
-    u_long blockingMode = 0;
-    ioctlsocket(state->clientSocket, FIONBIO, &blockingMode);
+    setNonBlocking(state->clientSocket, false);
 
-    char buffer[32768];
-    int serverAddrLen = sizeof(state->serverAddr);
+    static uint8_t buffer[MAX_PACKET_SIZE];
+    socklen_t serverAddrLen = sizeof(state->serverAddr);
 
     for (int attempt = 0; attempt < 3; attempt++) {
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(state->clientSocket, &readfds);
-
-        struct timeval timeout;
-        timeout.tv_sec = 3;
-        timeout.tv_usec = 0;
-
-        int result = select(0, &readfds, NULL, NULL, &timeout);
-
-        if (result > 0) {
-            int recvLen = recvfrom(state->clientSocket, buffer, sizeof(buffer) - 1, 0,
+        if (waitReadable(state->clientSocket, 3000)) {
+            int recvLen = recvfrom(state->clientSocket, (char*)buffer, sizeof(buffer), 0,
                 (sockaddr*)&state->serverAddr, &serverAddrLen);
 
             if (recvLen > 0) {
-                buffer[recvLen] = '\0';
-                std::string response(buffer);
-
-                if (response.substr(0, 6) == "ERROR:") {
-                    std::string errorType = response.substr(6);
-                    if (errorType == "CODE_REQUIRED") {
+                ByteReader reader(buffer, recvLen);
+                if (readMessageHeader(reader) == MSG_ERROR) {
+                    uint8_t errorCode = reader.readU8();
+                    if (errorCode == ERROR_CODE_REQUIRED) {
                         state->errorMessage = "Server requires a code";
                     }
-                    else if (errorType == "WRONG_CODE") {
+                    else if (errorCode == ERROR_WRONG_CODE) {
                         state->errorMessage = "Incorrect server code";
                     }
-                    else if (errorType == "SERVER_FULL") {
+                    else if (errorCode == ERROR_SERVER_FULL) {
                         state->errorMessage = "Server is full";
                     }
                     else {
                         state->errorMessage = "Connection error";
                     }
-                    closesocket(state->clientSocket);
+                    closeSocket(state->clientSocket);
                     state->clientSocket = INVALID_SOCKET;
                     return false;
                 }
 
-                parseServerResponse(state, response);
+                handleServerMessage(state, buffer, recvLen);
 
-                if (!state->assignedUUID.empty()) {
-                    u_long mode = 1;
-                    ioctlsocket(state->clientSocket, FIONBIO, &mode);
+                if (state->session != 0) {
+                    setNonBlocking(state->clientSocket, true);
                     return true;
                 }
             }
         }
 
         if (attempt < 2) {
-            sendto(state->clientSocket, initMessage.c_str(), initMessage.length(), 0,
-                (sockaddr*)&state->serverAddr, sizeof(state->serverAddr));
+            sendPacket(state, connectPacket, connectLength);
         }
     }
 
     state->errorMessage = "Connection timeout";
-    closesocket(state->clientSocket);
+    closeSocket(state->clientSocket);
     state->clientSocket = INVALID_SOCKET;
     return false;
 }
 
 bool connectToServerWithCode(AppState* state, const std::string& serverIP, int port, const std::string& serverCode) {
     if (state->clientSocket != INVALID_SOCKET) {
-        closesocket(state->clientSocket);
+        closeSocket(state->clientSocket);
     }
 
     state->clientSocket = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
@@ -772,98 +815,81 @@ bool connectToServerWithCode(AppState* state, const std::string& serverIP, int p
 
     if (inet_pton(AF_INET6, serverIP.c_str(), &state->serverAddr.sin6_addr) != 1) {
         state->errorMessage = "Invalid server address";
-        closesocket(state->clientSocket);
+        closeSocket(state->clientSocket);
         state->clientSocket = INVALID_SOCKET;
         return false;
     }
 
-    std::string initMessage = serverCode.empty() ?
-        "NONE:" + state->playerName + ":INIT" :
-        "NONE:" + state->playerName + ":CODE:" + serverCode;
+    uint8_t connectPacket[MESSAGE_HEADER_SIZE + 2 * (MAX_STRING_LENGTH + 1) + 8];
+    ByteWriter connectWriter(connectPacket, sizeof(connectPacket));
+    size_t connectLength = encodeConnect(connectWriter, state->playerName, serverCode, currentViewport());
+    state->session = 0;
+    sendPacket(state, connectPacket, connectLength);
 
-    sendto(state->clientSocket, initMessage.c_str(), initMessage.length(), 0,
-        (sockaddr*)&state->serverAddr, sizeof(state->serverAddr));
+    setNonBlocking(state->clientSocket, false);
 
-    u_long blockingMode = 0;
-    ioctlsocket(state->clientSocket, FIONBIO, &blockingMode);
-
-    char buffer[32768];
-    int serverAddrLen = sizeof(state->serverAddr);
+    static uint8_t buffer[MAX_PACKET_SIZE];
+    socklen_t serverAddrLen = sizeof(state->serverAddr);
 
     for (int attempt = 0; attempt < 3; attempt++) {
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(state->clientSocket, &readfds);
-
-        struct timeval timeout;
-        timeout.tv_sec = 3;
-        timeout.tv_usec = 0;
-
-        int result = select(0, &readfds, NULL, NULL, &timeout);
-
-        if (result > 0) {
-            int recvLen = recvfrom(state->clientSocket, buffer, sizeof(buffer) - 1, 0,
+        if (waitReadable(state->clientSocket, 3000)) {
+            int recvLen = recvfrom(state->clientSocket, (char*)buffer, sizeof(buffer), 0,
                 (sockaddr*)&state->serverAddr, &serverAddrLen);
 
             if (recvLen > 0) {
-                buffer[recvLen] = '\0';
-                std::string response(buffer);
-
-                if (response.substr(0, 6) == "ERROR:") {
-                    std::string errorType = response.substr(6);
-                    if (errorType == "CODE_REQUIRED") {
+                ByteReader reader(buffer, recvLen);
+                if (readMessageHeader(reader) == MSG_ERROR) {
+                    uint8_t errorCode = reader.readU8();
+                    if (errorCode == ERROR_CODE_REQUIRED) {
                         state->errorMessage = "Server requires a code";
                     }
-                    else if (errorType == "WRONG_CODE") {
+                    else if (errorCode == ERROR_WRONG_CODE) {
                         state->errorMessage = "Incorrect server code";
                     }
-                    else if (errorType == "SERVER_FULL") {
+                    else if (errorCode == ERROR_SERVER_FULL) {
                         state->errorMessage = "Server is full";
                     }
                     else {
                         state->errorMessage = "Connection error";
                     }
-                    closesocket(state->clientSocket);
+                    closeSocket(state->clientSocket);
                     state->clientSocket = INVALID_SOCKET;
                     return false;
                 }
 
-                parseServerResponse(state, response);
+                handleServerMessage(state, buffer, recvLen);
 
-                if (!state->assignedUUID.empty()) {
-                    u_long mode = 1;
-                    ioctlsocket(state->clientSocket, FIONBIO, &mode);
+                if (state->session != 0) {
+                    setNonBlocking(state->clientSocket, true);
                     return true;
                 }
             }
         }
 
         if (attempt < 2) {
-            sendto(state->clientSocket, initMessage.c_str(), initMessage.length(), 0,
-                (sockaddr*)&state->serverAddr, sizeof(state->serverAddr));
+            sendPacket(state, connectPacket, connectLength);
         }
     }
 
     state->errorMessage = "Connection timeout";
-    closesocket(state->clientSocket);
+    closeSocket(state->clientSocket);
     state->clientSocket = INVALID_SOCKET;
     return false;
 }
 
 int main(int argc, char* argv[]) {
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+    if (!initSockets()) {
         return 1;
     }
 
     if (!SDL_Init(SDL_INIT_VIDEO)) {
-        WSACleanup();
+        shutdownSockets();
         return 1;
     }
 
     if (TTF_Init() < 0) {
         SDL_Quit();
-        WSACleanup();
+        shutdownSockets();
         return 1;
     }
 
@@ -876,7 +902,7 @@ int main(int argc, char* argv[]) {
     if (!state.window) {
         TTF_Quit();
         SDL_Quit();
-        WSACleanup();
+        shutdownSockets();
         return 1;
     }
 
@@ -887,7 +913,7 @@ int main(int argc, char* argv[]) {
         SDL_DestroyWindow(state.window);
         TTF_Quit();
         SDL_Quit();
-        WSACleanup();
+        shutdownSockets();
         return 1;
     }
 
@@ -897,6 +923,7 @@ int main(int argc, char* argv[]) {
 
     SDL_Event event;
     while (state.running) {
+        Uint64 frameStart = SDL_GetTicks();
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_EVENT_QUIT) {
                 state.running = false;
@@ -905,6 +932,7 @@ int main(int argc, char* argv[]) {
             if (event.type == SDL_EVENT_WINDOW_RESIZED) {
                 WINDOW_WIDTH = event.window.data1;
                 WINDOW_HEIGHT = event.window.data2;
+                if (state.gameState == STATE_PLAYING) sendViewport(&state);
             }
 
             if (state.gameState == STATE_BROWSER) {
@@ -1125,7 +1153,7 @@ int main(int argc, char* argv[]) {
                             state.gameState = STATE_MENU;
                         }
                         if (state.clientSocket != INVALID_SOCKET) {
-                            closesocket(state.clientSocket);
+                            closeSocket(state.clientSocket);
                             state.clientSocket = INVALID_SOCKET;
                         }
                     }
@@ -1225,12 +1253,13 @@ int main(int argc, char* argv[]) {
 
             for (const auto& pair : state.otherPlayers) {
                 for (const auto& cell : pair.second.cells) {
-                    drawCell(&state, cell, false);
+                    const Player& other = pair.second;
+                    drawCell(&state, cell, other.name, other.colorR, other.colorG, other.colorB);
                 }
             }
 
             for (const auto& cell : state.myCells) {
-                drawCell(&state, cell, true);
+                drawCell(&state, cell, state.playerName, state.myColorR, state.myColorG, state.myColorB);
             }
 
             drawLeaderboard(&state);
@@ -1240,11 +1269,11 @@ int main(int argc, char* argv[]) {
             SDL_RenderPresent(state.renderer);
         }
 
-        SDL_Delay(16);
+        waitForNextFrame(&state, frameStart);
     }
 
     if (state.clientSocket != INVALID_SOCKET) {
-        closesocket(state.clientSocket);
+        closeSocket(state.clientSocket);
     }
 
     if (state.fontLarge) TTF_CloseFont(state.fontLarge);
@@ -1254,7 +1283,7 @@ int main(int argc, char* argv[]) {
     SDL_DestroyWindow(state.window);
     TTF_Quit();
     SDL_Quit();
-    WSACleanup();
+    shutdownSockets();
 
     return 0;
 }
\ No newline at end of file
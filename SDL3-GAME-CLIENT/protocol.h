@@ -0,0 +1,694 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include "network_common.h"
+
+// Binary wire protocol shared by the game server, client and server finder.
+// Every datagram is a fixed 6-byte header (magic, version, type, payload length)
+// followed by the payload. All values are little-endian. Variable-length parts
+// of a message are sections: a tag, an entry count and a byte length, so a
+// reader can skip sections it does not know.
+//
+// The three projects each carry a copy of this file; keep them identical.
+
+const uint16_t PROTOCOL_MAGIC = 0x4C42;  // "BL" on the wire
+const uint8_t PROTOCOL_VERSION = 5;
+const size_t MESSAGE_HEADER_SIZE = 6;
+const size_t SECTION_HEADER_SIZE = 5;
+const size_t MAX_PACKET_SIZE = 32768;
+const size_t MAX_STRING_LENGTH = 255;
+const size_t FRAGMENT_HEADER_SIZE = 8;
+const int MAX_FRAGMENTS = 32;
+
+enum MessageType : uint8_t {
+    // Client -> game server
+    MSG_CONNECT = 1,
+    MSG_INPUT = 2,
+    MSG_ACK = 3,
+    MSG_PONG = 4,
+    MSG_VIEWPORT = 5,
+    MSG_FOOD_RESYNC = 6,
+
+    // Game server -> client
+    MSG_WELCOME = 16,
+    MSG_ERROR = 17,
+    MSG_PING = 18,
+    MSG_SNAPSHOT = 19,
+    MSG_FRAGMENT = 20,
+
+    // Game server / client <-> server finder
+    MSG_REGISTER = 32,
+    MSG_REGISTER_OK = 33,
+    MSG_HEARTBEAT = 34,
+    MSG_QUERY = 35,
+    MSG_SERVER_LIST = 36
+};
+
+enum ErrorCode : uint8_t {
+    ERROR_CODE_REQUIRED = 1,
+    ERROR_WRONG_CODE = 2,
+    ERROR_SERVER_FULL = 3
+};
+
+enum SectionTag : uint8_t {
+    SECTION_PLAYERS = 1,
+    SECTION_FOOD_EVENTS = 2,
+    SECTION_SERVERS = 3,
+    SECTION_LEADERBOARD = 4,
+    SECTION_PLAYERS_REMOVED = 5,
+    SECTION_FOOD_CHECKSUM = 6,
+    SECTION_ENTITIES = 7
+};
+
+// MSG_INPUT flags
+const uint8_t INPUT_UP = 1 << 0;
+const uint8_t INPUT_DOWN = 1 << 1;
+const uint8_t INPUT_LEFT = 1 << 2;
+const uint8_t INPUT_RIGHT = 1 << 3;
+const uint8_t INPUT_SPLIT = 1 << 4;
+const uint8_t INPUT_MERGE = 1 << 5;
+const uint8_t INPUT_DIRECTIONS = INPUT_UP | INPUT_DOWN | INPUT_LEFT | INPUT_RIGHT;
+const int INPUT_FLAG_BITS = 6;
+
+// Every MSG_INPUT repeats the last few commands, so one lost packet loses nothing
+const int INPUT_REDUNDANCY = 4;
+
+// Writes into a caller-owned buffer. Running out of room sets overflow and
+// turns every later write into a no-op, so callers check once at the end.
+struct ByteWriter {
+    uint8_t* data;
+    size_t capacity;
+    size_t length = 0;
+    bool overflow = false;
+
+    ByteWriter(uint8_t* buffer, size_t size) : data(buffer), capacity(size) {}
+
+    bool ensure(size_t count) {
+        if (overflow || count > capacity - length) {
+            overflow = true;
+            return false;
+        }
+        return true;
+    }
+
+    void writeU8(uint8_t value) {
+        if (!ensure(1)) return;
+        data[length++] = value;
+    }
+
+    void writeU16(uint16_t value) {
+        if (!ensure(2)) return;
+        data[length++] = (uint8_t)value;
+        data[length++] = (uint8_t)(value >> 8);
+    }
+
+    void writeU32(uint32_t value) {
+        if (!ensure(4)) return;
+        for (int i = 0; i < 4; i++) data[length++] = (uint8_t)(value >> (i * 8));
+    }
+
+    void writeU64(uint64_t value) {
+        if (!ensure(8)) return;
+        for (int i = 0; i < 8; i++) data[length++] = (uint8_t)(value >> (i * 8));
+    }
+
+    void writeF32(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        writeU32(bits);
+    }
+
+    void writeBytes(const void* bytes, size_t count) {
+        if (!ensure(count)) return;
+        memcpy(data + length, bytes, count);
+        length += count;
+    }
+
+    // One length byte, then the bytes; longer strings are truncated
+    void writeString(const char* text, size_t count) {
+        if (count > MAX_STRING_LENGTH) count = MAX_STRING_LENGTH;
+        writeU8((uint8_t)count);
+        writeBytes(text, count);
+    }
+
+    void writeString(const std::string& text) {
+        writeString(text.data(), text.size());
+    }
+
+    void patchU16(size_t offset, uint16_t value) {
+        if (offset + 2 > length) return;
+        data[offset] = (uint8_t)value;
+        data[offset + 1] = (uint8_t)(value >> 8);
+    }
+};
+
+// Non-owning view of a string inside a received packet
+struct ByteString {
+    const char* data = "";
+    uint8_t length = 0;
+
+    std::string str() const {
+        return std::string(data, length);
+    }
+};
+
+// Reads from a received packet. Reading past the end sets failed and returns
+// zeros, so decoders can read a whole record and check failed once.
+struct ByteReader {
+    const uint8_t* data;
+    size_t length;
+    size_t pos = 0;
+    bool failed = false;
+
+    ByteReader(const void* buffer, size_t size) : data((const uint8_t*)buffer), length(size) {}
+
+    size_t remaining() const {
+        return length - pos;
+    }
+
+    bool ensure(size_t count) {
+        if (failed || count > length - pos) {
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    uint8_t readU8() {
+        if (!ensure(1)) return 0;
+        return data[pos++];
+    }
+
+    uint16_t readU16() {
+        if (!ensure(2)) return 0;
+        uint16_t value = (uint16_t)(data[pos] | (data[pos + 1] << 8));
+        pos += 2;
+        return value;
+    }
+
+    uint32_t readU32() {
+        if (!ensure(4)) return 0;
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= (uint32_t)data[pos++] << (i * 8);
+        return value;
+    }
+
+    uint64_t readU64() {
+        if (!ensure(8)) return 0;
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) value |= (uint64_t)data[pos++] << (i * 8);
+        return value;
+    }
+
+    float readF32() {
+        uint32_t bits = readU32();
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    ByteString readString() {
+        ByteString text;
+        uint8_t count = readU8();
+        if (!ensure(count)) return text;
+        text.data = (const char*)(data + pos);
+        text.length = count;
+        pos += count;
+        return text;
+    }
+
+    void skip(size_t count) {
+        if (ensure(count)) pos += count;
+    }
+};
+
+// Packs values of any width up to 32 bits into a ByteWriter, least
+// significant bit first. Whole bytes go out as soon as they fill, so a mark
+// is cheap and rewinding drops a record that did not fit. Call flush before
+// writing bytes again.
+struct BitWriter {
+    struct Mark {
+        size_t length;
+        uint64_t pending;
+        int pendingBits;
+    };
+
+    ByteWriter& bytes;
+    uint64_t pending = 0;
+    int pendingBits = 0;
+
+    explicit BitWriter(ByteWriter& writer) : bytes(writer) {}
+
+    void write(uint32_t value, int bitCount) {
+        uint64_t mask = (bitCount == 32) ? 0xFFFFFFFFull : ((1ull << bitCount) - 1);
+        pending |= (value & mask) << pendingBits;
+        pendingBits += bitCount;
+        while (pendingBits >= 8) {
+            bytes.writeU8((uint8_t)pending);
+            pending >>= 8;
+            pendingBits -= 8;
+        }
+    }
+
+    void writeSigned(int32_t value, int bitCount) {
+        write((uint32_t)value, bitCount);
+    }
+
+    // Pads the last partial byte with zeros
+    void flush() {
+        if (pendingBits > 0) bytes.writeU8((uint8_t)pending);
+        pending = 0;
+        pendingBits = 0;
+    }
+
+    Mark mark() const {
+        return { bytes.length, pending, pendingBits };
+    }
+
+    void rewind(const Mark& mark) {
+        bytes.length = mark.length;
+        bytes.overflow = false;
+        pending = mark.pending;
+        pendingBits = mark.pendingBits;
+    }
+};
+
+// Reads what a BitWriter wrote. Holds its own copy of the byte reader, so
+// copying a BitReader peeks ahead without consuming anything.
+struct BitReader {
+    ByteReader bytes;
+    uint64_t pending = 0;
+    int pendingBits = 0;
+
+    explicit BitReader(const ByteReader& reader) : bytes(reader) {}
+
+    bool failed() const {
+        return bytes.failed;
+    }
+
+    uint32_t read(int bitCount) {
+        while (pendingBits < bitCount) {
+            pending |= (uint64_t)bytes.readU8() << pendingBits;
+            pendingBits += 8;
+        }
+        uint64_t mask = (bitCount == 32) ? 0xFFFFFFFFull : ((1ull << bitCount) - 1);
+        uint32_t value = (uint32_t)(pending & mask);
+        pending >>= bitCount;
+        pendingBits -= bitCount;
+        return value;
+    }
+
+    int32_t readSigned(int bitCount) {
+        uint32_t value = read(bitCount);
+        uint32_t sign = 1u << (bitCount - 1);
+        return (int32_t)((value ^ sign) - sign);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Quantization
+// ---------------------------------------------------------------------------
+
+// Positions snap to a POSITION_STEP grid and travel as POSITION_BITS signed
+// offsets from the snapshot origin: at most 1/16 world unit off, an eighth of
+// a pixel at the client's 2x zoom, within about 4096 units of the viewer.
+const float POSITION_STEP = 0.125f;
+const int POSITION_BITS = 16;
+const int32_t POSITION_RANGE = (1 << (POSITION_BITS - 1)) - 1;
+
+// Sizes use a log scale between CELL_SIZE_MIN and CELL_SIZE_MAX, so the error grows
+// with the cell: about 0.02% of the size, half a pixel at CELL_SIZE_MAX.
+const int SIZE_BITS = 14;
+const float CELL_SIZE_MIN = 1.0f;
+const float CELL_SIZE_MAX = 1024.0f;
+
+inline int32_t quantizePosition(float value) {
+    return (int32_t)std::floor(value / POSITION_STEP + 0.5f);
+}
+
+inline float dequantizePosition(int32_t grid) {
+    return grid * POSITION_STEP;
+}
+
+// The grid position of value, clamped to what an offset from origin can reach
+inline int32_t quantizePositionNear(float value, int32_t origin) {
+    int32_t offset = quantizePosition(value) - origin;
+    if (offset > POSITION_RANGE) offset = POSITION_RANGE;
+    if (offset < -POSITION_RANGE) offset = -POSITION_RANGE;
+    return origin + offset;
+}
+
+inline uint16_t quantizeSize(float size) {
+    if (size <= CELL_SIZE_MIN) return 0;
+    if (size >= CELL_SIZE_MAX) return (1 << SIZE_BITS) - 1;
+    double scale = ((1 << SIZE_BITS) - 1) / std::log((double)CELL_SIZE_MAX / CELL_SIZE_MIN);
+    return (uint16_t)std::floor(std::log((double)size / CELL_SIZE_MIN) * scale + 0.5);
+}
+
+inline float dequantizeSize(uint16_t code) {
+    double scale = std::log((double)CELL_SIZE_MAX / CELL_SIZE_MIN) / ((1 << SIZE_BITS) - 1);
+    return (float)(CELL_SIZE_MIN * std::exp(code * scale));
+}
+
+// ---------------------------------------------------------------------------
+// Framing
+// ---------------------------------------------------------------------------
+
+inline void beginMessage(ByteWriter& writer, MessageType type) {
+    writer.writeU16(PROTOCOL_MAGIC);
+    writer.writeU8(PROTOCOL_VERSION);
+    writer.writeU8(type);
+    writer.writeU16(0);  // Payload length, patched by finishMessage
+}
+
+// Returns the datagram length, or 0 if the message did not fit
+inline size_t finishMessage(ByteWriter& writer) {
+    if (writer.overflow) return 0;
+    writer.patchU16(4, (uint16_t)(writer.length - MESSAGE_HEADER_SIZE));
+    return writer.length;
+}
+
+// Validates the header and narrows the reader to this message's payload.
+// Returns the message type, or 0 for anything that is not a valid message.
+inline uint8_t readMessageHeader(ByteReader& reader) {
+    uint16_t magic = reader.readU16();
+    uint8_t version = reader.readU8();
+    uint8_t type = reader.readU8();
+    uint16_t payloadLength = reader.readU16();
+    if (reader.failed || magic != PROTOCOL_MAGIC || version != PROTOCOL_VERSION) return 0;
+    if (payloadLength > reader.remaining()) return 0;
+    reader.length = reader.pos + payloadLength;
+    return type;
+}
+
+// Returns the offset to hand to endSection
+inline size_t beginSection(ByteWriter& writer, SectionTag tag) {
+    size_t start = writer.length;
+    writer.writeU8(tag);
+    writer.writeU16(0);  // Entry count
+    writer.writeU16(0);  // Byte length of the entries
+    return start;
+}
+
+inline void endSection(ByteWriter& writer, size_t start, uint16_t count) {
+    if (writer.overflow) return;
+    writer.patchU16(start + 1, count);
+    writer.patchU16(start + 3, (uint16_t)(writer.length - start - SECTION_HEADER_SIZE));
+}
+
+struct Section {
+    uint8_t tag = 0;
+    uint16_t count = 0;
+    ByteReader body = ByteReader(nullptr, 0);
+};
+
+// Reads the next section header and steps the reader past its body.
+// Returns false at the end of the message or on a malformed section.
+inline bool readSection(ByteReader& reader, Section& section) {
+    if (reader.remaining() < SECTION_HEADER_SIZE) return false;
+    section.tag = reader.readU8();
+    section.count = reader.readU16();
+    uint16_t byteLength = reader.readU16();
+    if (!reader.ensure(byteLength)) return false;
+    section.body = ByteReader(reader.data + reader.pos, byteLength);
+    reader.pos += byteLength;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Client -> game server
+// ---------------------------------------------------------------------------
+
+// What the client draws: its window in pixels and how many pixels one world
+// unit covers. The server sends whatever falls inside.
+struct Viewport {
+    uint16_t width = 1920;
+    uint16_t height = 1080;
+    float zoom = 2.0f;
+};
+
+inline void writeViewport(ByteWriter& writer, const Viewport& viewport) {
+    writer.writeU16(viewport.width);
+    writer.writeU16(viewport.height);
+    writer.writeF32(viewport.zoom);
+}
+
+inline bool readViewport(ByteReader& reader, Viewport& viewport) {
+    Viewport read;
+    read.width = reader.readU16();
+    read.height = reader.readU16();
+    read.zoom = reader.readF32();
+    if (reader.failed) return false;
+    viewport = read;
+    return true;
+}
+
+// The viewport trails the name and code; servers treat a connect without one
+// as the default 1920x1080 window
+inline size_t encodeConnect(ByteWriter& writer, const std::string& name, const std::string& code,
+    const Viewport& viewport) {
+    beginMessage(writer, MSG_CONNECT);
+    writer.writeString(name);
+    writer.writeString(code);
+    writeViewport(writer, viewport);
+    return finishMessage(writer);
+}
+
+// Sent again whenever the window is resized or the zoom changes
+inline size_t encodeViewport(ByteWriter& writer, uint64_t session, const Viewport& viewport) {
+    beginMessage(writer, MSG_VIEWPORT);
+    writer.writeU64(session);
+    writeViewport(writer, viewport);
+    return finishMessage(writer);
+}
+
+// MSG_ACK, MSG_PONG, MSG_FOOD_RESYNC and MSG_INPUT all start with the session id
+inline size_t encodeSessionMessage(ByteWriter& writer, MessageType type, uint64_t session) {
+    beginMessage(writer, type);
+    writer.writeU64(session);
+    return finishMessage(writer);
+}
+
+// The newest input command and the ones before it. flags[i] belongs to
+// command sequence - i; the sequence wraps around.
+struct InputCommands {
+    uint16_t sequence = 0;
+    uint8_t flags[INPUT_REDUNDANCY] = {};
+};
+
+// True if sequence a comes after b, allowing for wraparound
+inline bool inputSequenceNewer(uint16_t a, uint16_t b) {
+    return (int16_t)(uint16_t)(a - b) > 0;
+}
+
+// 19 bytes on the wire: the sequence and four 6-bit commands follow the session id
+inline size_t encodeInput(ByteWriter& writer, uint64_t session, const InputCommands& commands) {
+    beginMessage(writer, MSG_INPUT);
+    writer.writeU64(session);
+    writer.writeU16(commands.sequence);
+    BitWriter bits(writer);
+    for (int i = 0; i < INPUT_REDUNDANCY; i++) bits.write(commands.flags[i], INPUT_FLAG_BITS);
+    bits.flush();
+    return finishMessage(writer);
+}
+
+// Reads what follows the session id of a MSG_INPUT
+inline bool readInputCommands(ByteReader& reader, InputCommands& commands) {
+    commands.sequence = reader.readU16();
+    BitReader bits(reader);
+    for (int i = 0; i < INPUT_REDUNDANCY; i++) commands.flags[i] = (uint8_t)bits.read(INPUT_FLAG_BITS);
+    return !reader.failed && !bits.failed();
+}
+
+// Acknowledges the newest snapshot the client has rebuilt
+inline size_t encodeAck(ByteWriter& writer, uint64_t session, uint32_t sequence) {
+    beginMessage(writer, MSG_ACK);
+    writer.writeU64(session);
+    writer.writeU32(sequence);
+    return finishMessage(writer);
+}
+
+// ---------------------------------------------------------------------------
+// Game server -> client
+// ---------------------------------------------------------------------------
+
+struct WelcomeMessage {
+    uint64_t session;
+    uint32_t playerId;
+    uint32_t mapWidth;
+    uint32_t mapHeight;
+    uint8_t r, g, b;
+    // Seeded food layout (see seeded_food.h)
+    uint64_t foodSeed;
+    uint32_t foodChunkSize;
+    uint16_t foodPerChunk;
+};
+
+inline size_t encodeWelcome(ByteWriter& writer, const WelcomeMessage& welcome) {
+    beginMessage(writer, MSG_WELCOME);
+    writer.writeU64(welcome.session);
+    writer.writeU32(welcome.playerId);
+    writer.writeU32(welcome.mapWidth);
+    writer.writeU32(welcome.mapHeight);
+    writer.writeU8(welcome.r);
+    writer.writeU8(welcome.g);
+    writer.writeU8(welcome.b);
+    writer.writeU64(welcome.foodSeed);
+    writer.writeU32(welcome.foodChunkSize);
+    writer.writeU16(welcome.foodPerChunk);
+    return finishMessage(writer);
+}
+
+inline bool decodeWelcome(ByteReader& reader, WelcomeMessage& welcome) {
+    welcome.session = reader.readU64();
+    welcome.playerId = reader.readU32();
+    welcome.mapWidth = reader.readU32();
+    welcome.mapHeight = reader.readU32();
+    welcome.r = reader.readU8();
+    welcome.g = reader.readU8();
+    welcome.b = reader.readU8();
+    welcome.foodSeed = reader.readU64();
+    welcome.foodChunkSize = reader.readU32();
+    welcome.foodPerChunk = reader.readU16();
+    return !reader.failed;
+}
+
+inline size_t encodeError(ByteWriter& writer, ErrorCode code) {
+    beginMessage(writer, MSG_ERROR);
+    writer.writeU8(code);
+    return finishMessage(writer);
+}
+
+// Snapshot payload: the snapshot sequence, the baseline sequence it is a
+// delta against (0 for a full snapshot), the viewer's position and first cell
+// size, then sections. See snapshot_delta.h for the section contents.
+struct SnapshotHeader {
+    uint32_t sequence;
+    float x;
+    float y;
+    float size;
+};
+
+struct LeaderboardEntry {
+    uint16_t id;  // Entity id on this connection
+    float totalSize;
+};
+
+inline void writeLeaderboardEntry(ByteWriter& writer, uint16_t id, float totalSize) {
+    writer.writeU16(id);
+    writer.writeF32(totalSize);
+}
+
+inline bool readLeaderboardEntry(ByteReader& reader, LeaderboardEntry& entry) {
+    entry.id = reader.readU16();
+    entry.totalSize = reader.readF32();
+    return !reader.failed;
+}
+
+// A message too big for one datagram travels as MSG_FRAGMENT pieces: the
+// message id (the snapshot sequence), this piece's index, the piece count and
+// the byte offset of the piece within the message, then the bytes. The
+// receiver puts the pieces back together into the original datagram.
+struct FragmentHeader {
+    uint32_t messageId;
+    uint8_t index;
+    uint8_t count;
+    uint16_t offset;
+};
+
+inline size_t encodeFragment(ByteWriter& writer, const FragmentHeader& header, const uint8_t* bytes, size_t length) {
+    beginMessage(writer, MSG_FRAGMENT);
+    writer.writeU32(header.messageId);
+    writer.writeU8(header.index);
+    writer.writeU8(header.count);
+    writer.writeU16(header.offset);
+    writer.writeBytes(bytes, length);
+    return finishMessage(writer);
+}
+
+// Leaves the reader on the piece's bytes
+inline bool readFragmentHeader(ByteReader& reader, FragmentHeader& header) {
+    header.messageId = reader.readU32();
+    header.index = reader.readU8();
+    header.count = reader.readU8();
+    header.offset = reader.readU16();
+    if (reader.failed || header.count == 0 || header.count > MAX_FRAGMENTS || header.index >= header.count) return false;
+    return header.offset + reader.remaining() <= MAX_PACKET_SIZE;
+}
+
+// ---------------------------------------------------------------------------
+// Server finder
+// ---------------------------------------------------------------------------
+
+// MSG_REGISTER carries a ServerInfo without its address; the finder fills
+// that in from where the datagram came from
+inline size_t encodeRegister(ByteWriter& writer, const ServerInfo& info) {
+    beginMessage(writer, MSG_REGISTER);
+    writer.writeU16((uint16_t)info.port);
+    writer.writeU16((uint16_t)info.currentPlayers);
+    writer.writeU16((uint16_t)info.maxPlayers);
+    writer.writeU32((uint32_t)info.mapWidth);
+    writer.writeU32((uint32_t)info.mapHeight);
+    writer.writeU8(info.hasPassword ? 1 : 0);
+    writer.writeString(info.name);
+    writer.writeString(info.serverCode);
+    return finishMessage(writer);
+}
+
+inline bool decodeRegister(ByteReader& reader, ServerInfo& info) {
+    info.port = reader.readU16();
+    info.currentPlayers = reader.readU16();
+    info.maxPlayers = reader.readU16();
+    info.mapWidth = (int)reader.readU32();
+    info.mapHeight = (int)reader.readU32();
+    info.hasPassword = reader.readU8() != 0;
+    ByteString name = reader.readString();
+    ByteString code = reader.readString();
+    if (reader.failed) return false;
+    info.name.assign(name.data, name.length);
+    info.serverCode.assign(code.data, code.length);
+    return true;
+}
+
+inline size_t encodeHeartbeat(ByteWriter& writer, uint16_t port) {
+    beginMessage(writer, MSG_HEARTBEAT);
+    writer.writeU16(port);
+    return finishMessage(writer);
+}
+
+inline size_t encodeEmpty(ByteWriter& writer, MessageType type) {
+    beginMessage(writer, type);
+    return finishMessage(writer);
+}
+
+inline void writeServerEntry(ByteWriter& writer, const ServerInfo& info) {
+    writer.writeString(info.name);
+    writer.writeString(info.address);
+    writer.writeU16((uint16_t)info.port);
+    writer.writeU16((uint16_t)info.currentPlayers);
+    writer.writeU16((uint16_t)info.maxPlayers);
+    writer.writeU32((uint32_t)info.mapWidth);
+    writer.writeU32((uint32_t)info.mapHeight);
+    writer.writeU8(info.hasPassword ? 1 : 0);
+    writer.writeString(info.serverCode);
+}
+
+inline bool readServerEntry(ByteReader& reader, ServerInfo& info) {
+    ByteString name = reader.readString();
+    ByteString address = reader.readString();
+    info.port = reader.readU16();
+    info.currentPlayers = reader.readU16();
+    info.maxPlayers = reader.readU16();
+    info.mapWidth = (int)reader.readU32();
+    info.mapHeight = (int)reader.readU32();
+    info.hasPassword = reader.readU8() != 0;
+    ByteString code = reader.readString();
+    if (reader.failed) return false;
+    info.name.assign(name.data, name.length);
+    info.address.assign(address.data, address.length);
+    info.serverCode.assign(code.data, code.length);
+    return true;
+}
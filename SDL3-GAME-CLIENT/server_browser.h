@@ -3,13 +3,10 @@
 #include <string>
 #include <algorithm>
 #include <sstream>
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
 #include "network_common.h"
-
-#pragma comment(lib, "ws2_32.lib")
+#include "protocol.h"
 
 // Server Finder configuration - change these to match your server finder
 #ifndef SERVER_FINDER_IP_ADDR
@@ -52,59 +49,27 @@ inline void queryServerFinder(std::vector<ServerInfo>& servers) {
     finderAddr.sin6_port = htons(SERVER_FINDER_PORT_NUM);
     inet_pton(AF_INET6, SERVER_FINDER_IP_ADDR, &finderAddr.sin6_addr);
 
-    std::string queryMsg = "QUERY";
-    sendto(socket, queryMsg.c_str(), queryMsg.length(), 0,
+    uint8_t query[MESSAGE_HEADER_SIZE];
+    ByteWriter writer(query, sizeof(query));
+    size_t queryLength = encodeEmpty(writer, MSG_QUERY);
+    sendto(socket, (const char*)query, (int)queryLength, 0,
         (sockaddr*)&finderAddr, sizeof(finderAddr));
 
     // Wait for response with timeout
-    u_long blockingMode = 0;
-    ioctlsocket(socket, FIONBIO, &blockingMode);
-
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(socket, &readfds);
-
-    struct timeval timeout;
-    timeout.tv_sec = 3;
-    timeout.tv_usec = 0;
-
-    int result = select(0, &readfds, NULL, NULL, &timeout);
-
-    if (result > 0) {
-        char buffer[8192];
-        int recvLen = recvfrom(socket, buffer, sizeof(buffer) - 1, 0, NULL, NULL);
+    if (waitReadable(socket, 3000)) {
+        static uint8_t buffer[MAX_PACKET_SIZE];
+        int recvLen = recvfrom(socket, (char*)buffer, sizeof(buffer), 0, NULL, NULL);
 
         if (recvLen > 0) {
-            buffer[recvLen] = '\0';
-            std::string response(buffer);
-
-            if (response.substr(0, 8) == "SERVERS:") {
-                std::string serverData = response.substr(8);
-                std::stringstream ss(serverData);
-                std::string serverToken;
-
-                while (std::getline(ss, serverToken, ';')) {
-                    if (serverToken.empty()) continue;
-
-                    std::stringstream serverStream(serverToken);
-                    std::string token;
-                    std::vector<std::string> parts;
-
-                    while (std::getline(serverStream, token, ',')) {
-                        parts.push_back(token);
-                    }
+            ByteReader reader(buffer, recvLen);
+            if (readMessageHeader(reader) == MSG_SERVER_LIST) {
+                Section section;
+                while (readSection(reader, section)) {
+                    if (section.tag != SECTION_SERVERS) continue;
 
-                    if (parts.size() >= 8) {
+                    for (int i = 0; i < section.count; i++) {
                         ServerInfo info;
-                        info.name = parts[0];
-                        info.address = parts[1];
-                        info.port = std::stoi(parts[2]);
-                        info.currentPlayers = std::stoi(parts[3]);
-                        info.maxPlayers = std::stoi(parts[4]);
-                        info.mapWidth = std::stoi(parts[5]);
-                        info.mapHeight = std::stoi(parts[6]);
-                        info.hasPassword = (parts[7] == "1");
-                        info.serverCode = (parts.size() > 8) ? parts[8] : "";
+                        if (!readServerEntry(section.body, info)) break;
                         servers.push_back(info);
                     }
                 }
@@ -112,7 +77,7 @@ inline void queryServerFinder(std::vector<ServerInfo>& servers) {
         }
     }
 
-    closesocket(socket);
+    closeSocket(socket);
 }
 
 inline void drawTextHelper(SDL_Renderer* renderer, TTF_Font* font, const std::string& text,
@@ -0,0 +1,137 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// The one place that knows which socket API the platform has. Everything else
+// uses SOCKET, the helpers below and the BSD calls Winsock and POSIX share
+// (socket, bind, sendto, recvfrom, setsockopt, inet_pton, ...).
+// The three projects each carry a copy of this file; keep them identical.
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef WSAPOLLFD PollEntry;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+typedef int SOCKET;
+typedef pollfd PollEntry;
+const SOCKET INVALID_SOCKET = -1;
+const int SOCKET_ERROR = -1;
+#endif
+
+inline bool initSockets() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+    return true;
+#endif
+}
+
+inline void shutdownSockets() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+inline void closeSocket(SOCKET socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+inline void setNonBlocking(SOCKET socket, bool nonBlocking) {
+#ifdef _WIN32
+    u_long mode = nonBlocking ? 1 : 0;
+    ioctlsocket(socket, FIONBIO, &mode);
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    fcntl(socket, F_SETFL, nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#endif
+}
+
+// True when the last failed call on a non-blocking socket only meant "nothing to do yet"
+inline bool socketWouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+// Blocks until one socket is readable or timeoutMs passes. Returns true if it is readable.
+inline bool waitReadable(SOCKET socket, int timeoutMs) {
+    PollEntry entry = {};
+    entry.fd = socket;
+    entry.events = POLLIN;
+#ifdef _WIN32
+    return WSAPoll(&entry, 1, timeoutMs) > 0;
+#else
+    return poll(&entry, 1, timeoutMs) > 0;
+#endif
+}
+
+// Sleeps until any registered socket is readable or a timeout passes, so a
+// loop wakes exactly when there is a datagram or a timer due. epoll on Linux,
+// WSAPoll / poll elsewhere. Sockets are only watched, never read: the caller
+// drains them with non-blocking receives after wait returns.
+struct EventLoop {
+#ifdef __linux__
+    int epollFd = -1;
+#else
+    std::vector<PollEntry> entries;
+#endif
+
+    bool add(SOCKET socket) {
+#ifdef __linux__
+        if (epollFd < 0) epollFd = epoll_create1(0);
+        if (epollFd < 0) return false;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = socket;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &event) == 0;
+#else
+        PollEntry entry = {};
+        entry.fd = socket;
+        entry.events = POLLIN;
+        entries.push_back(entry);
+        return true;
+#endif
+    }
+
+    // Returns the number of readable sockets, 0 on timeout. A negative
+    // timeoutMs waits forever.
+    int wait(int timeoutMs) {
+#ifdef __linux__
+        epoll_event events[8];
+        int ready = epoll_wait(epollFd, events, 8, timeoutMs);
+#elif defined(_WIN32)
+        int ready = WSAPoll(entries.data(), (ULONG)entries.size(), timeoutMs);
+#else
+        int ready = poll(entries.data(), (nfds_t)entries.size(), timeoutMs);
+#endif
+        return (ready > 0) ? ready : 0;
+    }
+
+    void close() {
+#ifdef __linux__
+        if (epollFd >= 0) ::close(epollFd);
+        epollFd = -1;
+#else
+        entries.clear();
+#endif
+    }
+};
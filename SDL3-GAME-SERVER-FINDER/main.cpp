@@ -2,15 +2,18 @@
 #include <string>
 #include <map>
 #include <vector>
-#include <sstream>
 #include <chrono>
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <iphlpapi.h>
+#include <algorithm>
 #include "network_common.h"
+#include "protocol.h"
 
-#pragma comment(lib, "ws2_32.lib")
+#ifdef _WIN32
+#include <iphlpapi.h>
 #pragma comment(lib, "iphlpapi.lib")
+#else
+#include <ifaddrs.h>
+#include <net/if.h>
+#endif
 
 struct RegisteredServer {
     ServerInfo info;
@@ -21,7 +24,10 @@ struct RegisteredServer {
 
 std::map<std::string, RegisteredServer> servers;
 
-std::string getPublicIPv6Address() {
+// Fills addresses with the IPv6 addresses of interfaces that are up, minus
+// link-local and loopback ones. Returns an error message, or "" on success.
+std::string collectIPv6Addresses(std::vector<std::string>& addresses) {
+#ifdef _WIN32
     // Get adapter addresses
     ULONG bufferSize = 15000;
     PIP_ADAPTER_ADDRESSES pAddresses = (IP_ADAPTER_ADDRESSES*)malloc(bufferSize);
@@ -48,8 +54,6 @@ std::string getPublicIPv6Address() {
         return "Error getting adapters";
     }
 
-    std::vector<std::string> addresses;
-
     // Iterate through adapters
     PIP_ADAPTER_ADDRESSES pCurrAddresses = pAddresses;
     while (pCurrAddresses) {
@@ -77,6 +81,37 @@ std::string getPublicIPv6Address() {
     }
 
     free(pAddresses);
+#else
+    ifaddrs* interfaces = nullptr;
+    if (getifaddrs(&interfaces) != 0) {
+        return "Error getting adapters";
+    }
+
+    for (ifaddrs* current = interfaces; current; current = current->ifa_next) {
+        if (!current->ifa_addr || current->ifa_addr->sa_family != AF_INET6) continue;
+        if (!(current->ifa_flags & IFF_UP)) continue;
+
+        sockaddr_in6* sa6 = (sockaddr_in6*)current->ifa_addr;
+        char ipStr[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, &(sa6->sin6_addr), ipStr, INET6_ADDRSTRLEN);
+
+        std::string addr(ipStr);
+        if (addr.substr(0, 4) != "fe80" && addr != "::1") {
+            addresses.push_back(addr);
+        }
+    }
+
+    freeifaddrs(interfaces);
+#endif
+    return "";
+}
+
+std::string getPublicIPv6Address() {
+    std::vector<std::string> addresses;
+    std::string error = collectIPv6Addresses(addresses);
+    if (!error.empty()) {
+        return error;
+    }
 
     if (addresses.empty()) {
         return "No public IPv6 address found";
@@ -93,74 +128,60 @@ std::string getPublicIPv6Address() {
     return addresses[0];
 }
 
-void processMessage(const std::string& message, const std::string& clientIP, uint16_t clientPort,
+void sendMessage(SOCKET socket, const uint8_t* packet, size_t length, sockaddr_in6& clientAddr) {
+    if (length == 0) return;
+    sendto(socket, (const char*)packet, (int)length, 0, (sockaddr*)&clientAddr, sizeof(clientAddr));
+}
+
+void processMessage(const uint8_t* data, int length, const std::string& clientIP, uint16_t clientPort,
     SOCKET socket, sockaddr_in6& clientAddr) {
+    ByteReader reader(data, length);
+    uint8_t type = readMessageHeader(reader);
 
-    if (message.substr(0, 9) == "REGISTER:") {
-        // Format: REGISTER:name,port,currentPlayers,maxPlayers,mapW,mapH,hasPass,code
-        std::string data = message.substr(9);
-        std::stringstream ss(data);
-        std::string token;
-        std::vector<std::string> parts;
+    if (type == MSG_REGISTER) {
+        RegisteredServer regServer;
+        if (!decodeRegister(reader, regServer.info)) return;
+        regServer.info.address = clientIP;
+        regServer.ip = clientIP;
+        regServer.port = clientPort;
+        regServer.lastHeartbeat = std::chrono::steady_clock::now();
 
-        while (std::getline(ss, token, ',')) {
-            parts.push_back(token);
-        }
+        std::string serverKey = clientIP + ":" + std::to_string(regServer.info.port);
+        servers[serverKey] = regServer;
 
-        if (parts.size() >= 7) {
-            RegisteredServer regServer;
-            regServer.info.name = parts[0];
-            regServer.info.address = clientIP;
-            regServer.info.port = std::stoi(parts[1]);
-            regServer.info.currentPlayers = std::stoi(parts[2]);
-            regServer.info.maxPlayers = std::stoi(parts[3]);
-            regServer.info.mapWidth = std::stoi(parts[4]);
-            regServer.info.mapHeight = std::stoi(parts[5]);
-            regServer.info.hasPassword = (parts[6] == "1");
-            regServer.info.serverCode = (parts.size() > 7) ? parts[7] : "";
-            regServer.ip = clientIP;
-            regServer.port = clientPort;
-            regServer.lastHeartbeat = std::chrono::steady_clock::now();
-
-            std::string serverKey = clientIP + ":" + std::to_string(regServer.info.port);
-            servers[serverKey] = regServer;
-
-            std::cout << "[REGISTER] " << regServer.info.name << " (" << serverKey << ")" << std::endl;
-
-            std::string response = "OK";
-            sendto(socket, response.c_str(), (int)response.length(), 0,
-                (sockaddr*)&clientAddr, sizeof(clientAddr));
-        }
+        std::cout << "[REGISTER] " << regServer.info.name << " (" << serverKey << ")" << std::endl;
+
+        uint8_t response[MESSAGE_HEADER_SIZE];
+        ByteWriter writer(response, sizeof(response));
+        sendMessage(socket, response, encodeEmpty(writer, MSG_REGISTER_OK), clientAddr);
     }
-    else if (message == "QUERY") {
-        // Send list of all servers
-        std::stringstream response;
-        response << "SERVERS:";
+    else if (type == MSG_QUERY) {
+        // Send list of all servers that fit in one datagram
+        static uint8_t response[MAX_PACKET_SIZE];
+        ByteWriter writer(response, sizeof(response));
+        beginMessage(writer, MSG_SERVER_LIST);
+        size_t section = beginSection(writer, SECTION_SERVERS);
+        uint16_t count = 0;
 
-        bool first = true;
         for (const auto& pair : servers) {
-            if (!first) response << ";";
-            const ServerInfo& info = pair.second.info;
-            response << info.name << ","
-                << info.address << ","
-                << info.port << ","
-                << info.currentPlayers << ","
-                << info.maxPlayers << ","
-                << info.mapWidth << ","
-                << info.mapHeight << ","
-                << (info.hasPassword ? "1" : "0") << ","
-                << info.serverCode;
-            first = false;
+            size_t mark = writer.length;
+            writeServerEntry(writer, pair.second.info);
+            if (writer.overflow) {
+                writer.length = mark;
+                writer.overflow = false;
+                break;
+            }
+            count++;
         }
+        endSection(writer, section, count);
+        sendMessage(socket, response, finishMessage(writer), clientAddr);
 
-        std::string responseStr = response.str();
-        sendto(socket, responseStr.c_str(), (int)responseStr.length(), 0,
-            (sockaddr*)&clientAddr, sizeof(clientAddr));
-
-        std::cout << "[QUERY] Sent " << servers.size() << " servers to client" << std::endl;
+        std::cout << "[QUERY] Sent " << count << " servers to client" << std::endl;
     }
-    else if (message.substr(0, 11) == "HEARTBEAT:") {
-        std::string serverKey = message.substr(11);
+    else if (type == MSG_HEARTBEAT) {
+        uint16_t port = reader.readU16();
+        if (reader.failed) return;
+        std::string serverKey = clientIP + ":" + std::to_string(port);
         if (servers.find(serverKey) != servers.end()) {
             servers[serverKey].lastHeartbeat = std::chrono::steady_clock::now();
         }
@@ -187,16 +208,15 @@ void checkServerTimeouts() {
 }
 
 int main() {
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        std::cerr << "WSAStartup failed" << std::endl;
+    if (!initSockets()) {
+        std::cerr << "Socket startup failed" << std::endl;
         return 1;
     }
 
     SOCKET serverSocket = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
     if (serverSocket == INVALID_SOCKET) {
         std::cerr << "Socket creation failed" << std::endl;
-        WSACleanup();
+        shutdownSockets();
         return 1;
     }
 
@@ -206,19 +226,21 @@ int main() {
     serverAddr.sin6_addr = in6addr_any;
     serverAddr.sin6_port = htons(SERVER_FINDER_PORT);
 
-    DWORD ipv6only = 0;
+    int ipv6only = 0;
     setsockopt(serverSocket, IPPROTO_IPV6, IPV6_V6ONLY, (char*)&ipv6only, sizeof(ipv6only));
 
-    u_long mode = 1;
-    ioctlsocket(serverSocket, FIONBIO, &mode);
+    setNonBlocking(serverSocket, true);
 
     if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
         std::cerr << "Bind failed" << std::endl;
-        closesocket(serverSocket);
-        WSACleanup();
+        closeSocket(serverSocket);
+        shutdownSockets();
         return 1;
     }
 
+    EventLoop events;
+    events.add(serverSocket);
+
     std::cout << "==================================================" << std::endl;
     std::cout << "Server Finder Running on Port " << SERVER_FINDER_PORT << std::endl;
     std::cout << "==================================================" << std::endl;
@@ -230,42 +252,40 @@ int main() {
 
     char buffer[4096];
     sockaddr_in6 clientAddr;
-    int clientAddrLen = sizeof(clientAddr);
     auto lastTimeoutCheck = std::chrono::steady_clock::now();
+    const auto TIMEOUT_CHECK_INTERVAL = std::chrono::seconds(10);
 
     while (true) {
         auto now = std::chrono::steady_clock::now();
 
-        // Check for timeouts every 10 seconds
-        if (std::chrono::duration_cast<std::chrono::seconds>(now - lastTimeoutCheck).count() >= 10) {
+        if (now - lastTimeoutCheck >= TIMEOUT_CHECK_INTERVAL) {
             checkServerTimeouts();
             lastTimeoutCheck = now;
         }
 
-        memset(buffer, 0, sizeof(buffer));
-        int recvLen = recvfrom(serverSocket, buffer, sizeof(buffer) - 1, 0,
+        socklen_t clientAddrLen = sizeof(clientAddr);
+        int recvLen = recvfrom(serverSocket, buffer, sizeof(buffer), 0,
             (sockaddr*)&clientAddr, &clientAddrLen);
 
         if (recvLen == SOCKET_ERROR) {
-            int error = WSAGetLastError();
-            if (error == WSAEWOULDBLOCK) {
-                Sleep(100);
-                continue;
+            // Sleep until a datagram arrives or the next timeout check is due
+            if (socketWouldBlock()) {
+                auto untilCheck = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    lastTimeoutCheck + TIMEOUT_CHECK_INTERVAL - now).count() + 1;
+                events.wait((int)std::max<long long>(untilCheck, 0));
             }
             continue;
         }
 
-        buffer[recvLen] = '\0';
-        std::string message(buffer);
-
         char clientIP[INET6_ADDRSTRLEN];
         inet_ntop(AF_INET6, &(clientAddr.sin6_addr), clientIP, INET6_ADDRSTRLEN);
         uint16_t clientPort = ntohs(clientAddr.sin6_port);
 
-        processMessage(message, std::string(clientIP), clientPort, serverSocket, clientAddr);
+        processMessage((const uint8_t*)buffer, recvLen, std::string(clientIP), clientPort, serverSocket, clientAddr);
     }
 
-    closesocket(serverSocket);
-    WSACleanup();
+    events.close();
+    closeSocket(serverSocket);
+    shutdownSockets();
     return 0;
 }
\ No newline at end of file
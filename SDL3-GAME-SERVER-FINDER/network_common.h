@@ -1,7 +1,6 @@
 #pragma once
 #include <string>
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "socket_platform.h"
 
 // Server Finder Address (configurable)
 const std::string SERVER_FINDER_IP = "::1";  // Change this to your server finder IP
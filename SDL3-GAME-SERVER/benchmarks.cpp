@@ -0,0 +1,904 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "game_server.h"
+
+// Micro-benchmarks the server runs instead of serving when started with --benchmark
+
+double timeFoodKernel(WithinRadiusKernel kernel, const std::vector<float>& xs, const std::vector<float>& ys,
+    const std::vector<float>& centers, float radiusSq, std::vector<int>& hits, long long& found) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q + 1 < centers.size(); q += 2) {
+        found += kernel(xs.data(), ys.data(), (int)xs.size(),
+            centers[q], centers[q + 1], radiusSq, hits.data());
+    }
+    return elapsedMs(start, std::chrono::steady_clock::now());
+}
+
+// Compares the old per-dot checkCollision scan with the structure-of-arrays distance kernels
+void runFoodBenchmark() {
+    const int sizes[] = { 10000, 100000, 1000000 };
+    const int QUERIES = 200;
+    const float cellRadius = 50.0f;
+    float radiusSq = (cellRadius + FOOD_SIZE) * (cellRadius + FOOD_SIZE);
+
+    std::mt19937 benchGen(12345);
+    std::uniform_real_distribution<float> position(0.0f, (float)MAP_WIDTH);
+
+    std::cout << "Food distance benchmark: " << QUERIES << " full scans per size, runtime kernel = "
+        << withinRadiusSelection().name << std::endl;
+    std::cout << std::setw(10) << "food" << std::setw(16) << "checkCollision"
+        << std::setw(12) << "SoA scalar" << std::setw(10) << "SSE2" << std::setw(10) << "AVX2"
+        << "   (ms per scan)" << std::endl;
+
+    for (int size : sizes) {
+        std::vector<FoodDot> dots(size);
+        std::vector<float> xs(size);
+        std::vector<float> ys(size);
+        for (int i = 0; i < size; i++) {
+            dots[i].id = i;
+            dots[i].x = xs[i] = position(benchGen);
+            dots[i].y = ys[i] = position(benchGen);
+            dots[i].r = dots[i].g = dots[i].b = 255;
+        }
+
+        std::vector<float> centers(QUERIES * 2);
+        for (float& c : centers) c = position(benchGen);
+        std::vector<int> hits(size);
+
+        long long baselineFound = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int q = 0; q < QUERIES; q++) {
+            for (const FoodDot& dot : dots) {
+                if (checkCollision(centers[q * 2], centers[q * 2 + 1], cellRadius, dot.x, dot.y, FOOD_SIZE)) {
+                    baselineFound++;
+                }
+            }
+        }
+        double baselineMs = elapsedMs(start, std::chrono::steady_clock::now());
+
+        long long scalarFound = 0;
+        double scalarMs = timeFoodKernel(withinRadiusScalar, xs, ys, centers, radiusSq, hits, scalarFound);
+
+        std::cout << std::fixed << std::setprecision(4)
+            << std::setw(10) << size << std::setw(16) << baselineMs / QUERIES
+            << std::setw(12) << scalarMs / QUERIES;
+
+        bool matches = (scalarFound == baselineFound);
+#ifdef FOOD_KERNELS_X86
+        long long sseFound = 0;
+        double sseMs = timeFoodKernel(withinRadiusSSE2, xs, ys, centers, radiusSq, hits, sseFound);
+        std::cout << std::setw(10) << sseMs / QUERIES;
+        matches = matches && (sseFound == baselineFound);
+
+        if (cpuSupportsAVX2()) {
+            long long avxFound = 0;
+            double avxMs = timeFoodKernel(withinRadiusAVX2, xs, ys, centers, radiusSq, hits, avxFound);
+            std::cout << std::setw(10) << avxMs / QUERIES;
+            matches = matches && (avxFound == baselineFound);
+        }
+        else {
+            std::cout << std::setw(10) << "n/a";
+        }
+#else
+        std::cout << std::setw(10) << "n/a" << std::setw(10) << "n/a";
+#endif
+        std::cout << (matches ? "" : "   MISMATCH") << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout.precision(6);
+}
+
+// Pre-binary text snapshot, kept only as the baseline for the protocol benchmark
+std::string encodeTextSnapshot(const PlayerData& viewer, const SlotMap<PlayerData>& players,
+    const std::vector<std::string>& uuids, const FoodStore& food) {
+    std::stringstream ss;
+    ss << "POS:" << viewer.cells[0].x << "," << viewer.cells[0].y << "|SIZE:" << viewer.cells[0].size << "|PLAYERS:";
+    bool first = true;
+    for (size_t i = 0; i < players.size(); i++) {
+        const PlayerData& player = players.values[i];
+        for (const auto& cell : player.cells) {
+            if (!first) ss << ";";
+            ss << uuids[i] << "," << player.name << ","
+                << std::fixed << std::setprecision(2) << cell.x << ","
+                << std::fixed << std::setprecision(2) << cell.y << ","
+                << std::fixed << std::setprecision(2) << cell.size << ","
+                << (int)player.colorR << "," << (int)player.colorG << "," << (int)player.colorB;
+            first = false;
+        }
+    }
+
+    ss << "|FOOD:";
+    first = true;
+    // Same view rectangle as the binary snapshot, so both formats carry the same food
+    float halfWidth = viewer.viewHalfWidth + FOOD_SIZE;
+    float halfHeight = viewer.viewHalfHeight + FOOD_SIZE;
+    food.grid.queryRect(viewer.cells[0].x - halfWidth, viewer.cells[0].y - halfHeight,
+        viewer.cells[0].x + halfWidth, viewer.cells[0].y + halfHeight, [&](const SpatialGrid::Entry& entry) {
+        uint32_t color = food.colors[entry.slot];
+        if (!first) ss << ";";
+        ss << food.ids[entry.slot] << ","
+            << std::fixed << std::setprecision(2) << entry.x << ","
+            << std::fixed << std::setprecision(2) << entry.y << ","
+            << (int)((color >> 16) & 0xFF) << "," << (int)((color >> 8) & 0xFF) << "," << (int)(color & 0xFF);
+        first = false;
+        return true;
+    });
+    return ss.str();
+}
+
+// What the old client parsed out of a text snapshot
+struct TextCell {
+    float x;
+    float y;
+    float size;
+};
+
+struct TextFood {
+    uint32_t id;
+    float x;
+    float y;
+    uint8_t r, g, b;
+};
+
+// Parses the text snapshot the way the client used to; returns cells + food decoded
+size_t decodeTextSnapshot(const std::string& message, std::vector<TextCell>& cells, std::vector<TextFood>& foods) {
+    cells.clear();
+    foods.clear();
+    std::stringstream ss(message);
+    std::string token;
+    while (std::getline(ss, token, '|')) {
+        if (token.substr(0, 8) == "PLAYERS:") {
+            std::stringstream playerStream(token.substr(8));
+            std::string playerToken;
+            while (std::getline(playerStream, playerToken, ';')) {
+                std::stringstream playerInfo(playerToken);
+                std::string uuid, name, xStr, yStr, sizeStr, rStr, gStr, bStr;
+                std::getline(playerInfo, uuid, ',');
+                std::getline(playerInfo, name, ',');
+                std::getline(playerInfo, xStr, ',');
+                std::getline(playerInfo, yStr, ',');
+                std::getline(playerInfo, sizeStr, ',');
+                std::getline(playerInfo, rStr, ',');
+                std::getline(playerInfo, gStr, ',');
+                std::getline(playerInfo, bStr, ',');
+                TextCell cell = { std::stof(xStr), std::stof(yStr), std::stof(sizeStr) };
+                std::stoi(rStr);
+                std::stoi(gStr);
+                std::stoi(bStr);
+                cells.push_back(cell);
+            }
+        }
+        else if (token.substr(0, 5) == "FOOD:") {
+            std::stringstream foodStream(token.substr(5));
+            std::string foodToken;
+            while (std::getline(foodStream, foodToken, ';')) {
+                std::stringstream foodInfo(foodToken);
+                std::string idStr, xStr, yStr, rStr, gStr, bStr;
+                std::getline(foodInfo, idStr, ',');
+                std::getline(foodInfo, xStr, ',');
+                std::getline(foodInfo, yStr, ',');
+                std::getline(foodInfo, rStr, ',');
+                std::getline(foodInfo, gStr, ',');
+                std::getline(foodInfo, bStr, ',');
+                TextFood dot = { (uint32_t)std::stoi(idStr), std::stof(xStr), std::stof(yStr),
+                    (uint8_t)std::stoi(rStr), (uint8_t)std::stoi(gStr), (uint8_t)std::stoi(bStr) };
+                foods.push_back(dot);
+            }
+        }
+    }
+    return cells.size() + foods.size();
+}
+
+// Byte length and entry count of one section of a binary snapshot
+size_t snapshotSectionBytes(const uint8_t* packet, size_t length, SectionTag tag, size_t& count) {
+    ByteReader reader(packet, length);
+    count = 0;
+    if (readMessageHeader(reader) != MSG_SNAPSHOT) return 0;
+    reader.skip(20);
+    Section section;
+    while (readSection(reader, section)) {
+        if (section.tag != tag) continue;
+        count = section.count;
+        return section.body.length;
+    }
+    return 0;
+}
+
+// Food the table holds inside the viewer's view rectangle, the one the text snapshot uses
+size_t countFoodInView(const FoodTable& table, const PlayerData& viewer) {
+    int32_t minX = quantizePosition(viewer.cells[0].x - viewer.viewHalfWidth - FOOD_SIZE);
+    int32_t minY = quantizePosition(viewer.cells[0].y - viewer.viewHalfHeight - FOOD_SIZE);
+    int32_t maxX = quantizePosition(viewer.cells[0].x + viewer.viewHalfWidth + FOOD_SIZE);
+    int32_t maxY = quantizePosition(viewer.cells[0].y + viewer.viewHalfHeight + FOOD_SIZE);
+    size_t count = 0;
+    for (const auto& entry : table.chunks) {
+        const FoodTable::Chunk& chunk = entry.second;
+        for (size_t slot = 0; slot < chunk.dots.size(); slot++) {
+            const SeededDot& dot = chunk.dots[slot];
+            if (!chunk.eaten[slot] && dot.x >= minX && dot.x <= maxX && dot.y >= minY && dot.y <= maxY) count++;
+        }
+    }
+    for (const auto& entry : table.dots) {
+        const SnapshotFood& dot = entry.second;
+        if (dot.x >= minX && dot.x <= maxX && dot.y >= minY && dot.y <= maxY) count++;
+    }
+    return count;
+}
+
+// Decodes a full snapshot into state and its food events into a fresh table;
+// returns the cells plus the food it puts in the viewer's view
+size_t decodeBinarySnapshot(const uint8_t* packet, size_t length, const PlayerData& viewer, SnapshotState& state,
+    FoodTable& table) {
+    ByteReader reader(packet, length);
+    static std::vector<EntityInfo> announced;
+    static FoodUpdate update;
+    if (readMessageHeader(reader) != MSG_SNAPSHOT || !decodeSnapshotDelta(reader, nullptr, state, announced, update)) return 0;
+    table.clear();
+    if (!table.apply(update)) return 0;
+    return state.cells.size() + countFoodInView(table, viewer);
+}
+
+bool sameSnapshot(const SnapshotState& a, const SnapshotState& b) {
+    if (a.players.size() != b.players.size()) return false;
+    if (!(a.leaderboard == b.leaderboard)) return false;
+    for (size_t i = 0; i < a.players.size(); i++) {
+        const SnapshotPlayer& pa = a.players[i];
+        const SnapshotPlayer& pb = b.players[i];
+        if (pa.id != pb.id || pa.cellCount != pb.cellCount) return false;
+        for (int c = 0; c < pa.cellCount; c++) {
+            if (!sameCell(a.cellsOf(pa)[c], b.cellsOf(pb)[c])) return false;
+        }
+    }
+    return true;
+}
+
+// Whether the client's table holds what the server thinks it does, and every
+// seeded dot it laid out itself is one the server still has, or has eaten
+bool sameFood(const FoodTable& table, const FoodSync& sync, const SeededFood& seeded, const FoodStore& food) {
+    if (table.dots.size() != sync.droppedCount || table.chunks.size() != sync.chunks.size()) return false;
+    for (const FoodSync::KnownChunk& known : sync.chunks) {
+        for (const SnapshotFood& dot : known.dropped) {
+            auto it = table.dots.find(dot.id);
+            if (it == table.dots.end() || it->second.x != dot.x || it->second.y != dot.y || it->second.color != dot.color) {
+                return false;
+            }
+        }
+        auto it = table.chunks.find(known.chunk);
+        if (it == table.chunks.end() || it->second.generation != known.generation) return false;
+        const FoodTable::Chunk& chunk = it->second;
+        if (chunk.dots.size() != FOOD_LAYOUT.slotsIn(known.chunk)) return false;
+        if ((uint32_t)std::count(chunk.eaten.begin(), chunk.eaten.end(), 1) != known.eaten) return false;
+        if (seeded.chunks[known.chunk].generation != known.generation) continue;  // Regrown since
+        for (uint32_t slot = 0; slot < chunk.dots.size(); slot++) {
+            int index = food.find((int)((known.chunk << FOOD_SLOT_BITS) | slot));
+            if (chunk.eaten[slot]) continue;
+            if (index < 0) {
+                // Eaten after the client's last update
+                if (std::find(seeded.chunks[known.chunk].eatOrder.begin(), seeded.chunks[known.chunk].eatOrder.end(),
+                    slot) == seeded.chunks[known.chunk].eatOrder.end()) return false;
+                continue;
+            }
+            if (quantizePosition(food.x(index)) != chunk.dots[slot].x ||
+                quantizePosition(food.y(index)) != chunk.dots[slot].y || food.colors[index] != chunk.dots[slot].color) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Encodes and decodes the same snapshot in the old text format and the binary protocol
+void runProtocolBenchmark() {
+    const int ITERATIONS = 2000;
+    const int PLAYERS = 50;
+    const float WORLD_SIZE = 2000.0f;
+
+    std::mt19937 benchGen(12345);
+    // Every player crowds onto the viewer's screen, so both formats carry the same cells
+    std::uniform_real_distribution<float> onScreenX(WORLD_SIZE / 2 - VIEW_HALF_WIDTH + 50.0f, WORLD_SIZE / 2 + VIEW_HALF_WIDTH - 50.0f);
+    std::uniform_real_distribution<float> onScreenY(WORLD_SIZE / 2 - VIEW_HALF_HEIGHT + 50.0f, WORLD_SIZE / 2 + VIEW_HALF_HEIGHT - 50.0f);
+    std::uniform_int_distribution<int> cellCount(1, 4);
+
+    SlotMap<PlayerData> players;
+    players.init(PLAYERS);
+    std::vector<std::string> uuids;
+    for (int i = 0; i < PLAYERS; i++) {
+        PlayerData player;
+        player.session = benchGen();
+        player.name = "player" + std::to_string(i);
+        player.colorR = 255;
+        player.colorG = 150;
+        player.colorB = 100;
+        int cells = (i == 0) ? 1 : cellCount(benchGen);
+        for (int c = 0; c < cells; c++) {
+            Cell cell;
+            cell.x = (i == 0) ? WORLD_SIZE / 2 : onScreenX(benchGen);
+            cell.y = (i == 0) ? WORLD_SIZE / 2 : onScreenY(benchGen);
+            cell.size = 20.0f + c * 7.5f;
+            player.cells.push_back(cell);
+        }
+        players.insert(player);
+
+        char uuid[40];
+        snprintf(uuid, sizeof(uuid), "%08x-%04x-%04x-%04x-%012llx", (unsigned)benchGen(),
+            (unsigned)(benchGen() & 0xFFFF), (unsigned)(benchGen() & 0xFFFF), (unsigned)(benchGen() & 0xFFFF),
+            (unsigned long long)(benchGen() & 0xFFFFFFFFFFFFull));
+        uuids.push_back(uuid);
+    }
+
+    // 4000 seeded dots over the benchmark world
+    FoodLayout savedLayout = FOOD_LAYOUT;
+    FOOD_LAYOUT.init(12345, (uint32_t)WORLD_SIZE, (uint32_t)WORLD_SIZE, FOOD_CHUNK_SIZE,
+        (uint32_t)(4000.0f * FOOD_CHUNK_SIZE * FOOD_CHUNK_SIZE / (WORLD_SIZE * WORLD_SIZE)));
+    FoodStore food;
+    SeededFood seeded;
+    food.init(WORLD_SIZE, WORLD_SIZE, 80.0f);
+    initSeededFood(seeded);
+    plantAllFood(seeded, food);
+
+    const PlayerData& viewer = players.values[0];
+    LooseQuadtree broadphase;
+    std::vector<VisibleCell> visible;
+    std::vector<std::pair<float, int>> ranking;
+    std::vector<std::pair<float, PlayerHandle>> leaderboard;
+    std::vector<uint32_t> visibleChunks;
+    SnapshotState current;
+    SnapshotState decoded;
+    FoodTable decodedFood;
+    decodedFood.layout = FOOD_LAYOUT;
+    std::vector<EntityInfo> announcements;
+    static uint8_t packet[MAX_PACKET_SIZE];
+    std::vector<TextCell> cells;
+    std::vector<TextFood> foods;
+    cells.reserve(1024);
+    foods.reserve(4096);
+
+    size_t textBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        textBytes = encodeTextSnapshot(viewer, players, uuids, food).size();
+    }
+    double textEncodeMs = elapsedMs(start, std::chrono::steady_clock::now());
+
+    std::string text = encodeTextSnapshot(viewer, players, uuids, food);
+    size_t textDecoded = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        textDecoded = decodeTextSnapshot(text, cells, foods);
+    }
+    double textDecodeMs = elapsedMs(start, std::chrono::steady_clock::now());
+
+    size_t binaryBytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        // The server shares the broadphase and leaderboard across clients; rebuild them here to time the full encode
+        buildBroadphase(players, broadphase);
+        buildLeaderboard(players, ranking, leaderboard);
+        ByteWriter writer(packet, sizeof(packet));
+        // Nothing is ever acknowledged here, so every snapshot is a full one
+        binaryBytes = encodeSnapshot(writer, players, 0, leaderboard, broadphase, seeded, visible,
+            visibleChunks, current, announcements, sizeof(packet));
+    }
+    double binaryEncodeMs = elapsedMs(start, std::chrono::steady_clock::now());
+
+    size_t binaryDecoded = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        binaryDecoded = decodeBinarySnapshot(packet, binaryBytes, viewer, decoded, decodedFood);
+    }
+    double binaryDecodeMs = elapsedMs(start, std::chrono::steady_clock::now());
+
+    // Per-cell cost of the player records; the text format repeats uuid, name and color in each
+    size_t playersStart = text.find("PLAYERS:") + 8;
+    size_t textPlayerBytes = text.find('|', playersStart) - playersStart;
+    size_t textCells = cells.size();
+    size_t playerRecords = 0, announced = 0;
+    size_t binaryPlayerBytes = snapshotSectionBytes(packet, binaryBytes, SECTION_PLAYERS, playerRecords);
+    size_t metadataBytes = snapshotSectionBytes(packet, binaryBytes, SECTION_ENTITIES, announced);
+
+    // Steady state: a few players drift, a few dots in view are eaten each
+    // tick and chunks regrow, now and then a dot is dropped, and the client
+    // acknowledges snapshots ACK_LAG ticks late, as it would over a real
+    // round trip
+    const int DELTA_TICKS = 200;
+    const int ACK_LAG = 3;
+    const int FOOD_CHURN = 2;
+    const int DROP_INTERVAL = 10;
+    std::uniform_int_distribution<int> mover(1, PLAYERS - 1);
+    std::uniform_real_distribution<float> drift(-1.0f, 1.0f);
+    const size_t SEND_BUDGET = 160;  // Bytes per snapshot on a constrained link
+    std::vector<SnapshotState> clientRing(SNAPSHOT_HISTORY);
+    FoodTable clientFood;
+    FoodUpdate foodUpdate;
+    std::vector<int> inView;
+    std::vector<int> waited;
+    int nextFoodId = DROPPED_FOOD_ID_BASE;
+
+    // Runs the steady state with snapshots held to budget bytes. Reports the
+    // average and largest snapshot, the most snapshots in a row any player's
+    // record waited, how far the client's food fell behind and how often its
+    // stream was reset, and whether the client always rebuilt what was sent.
+    struct DeltaRun {
+        size_t bytes = 0;
+        size_t largest = 0;
+        int longestWait = 0;
+        uint32_t foodBehind = 0;
+        int foodResets = 0;
+        bool matches = true;
+    };
+    auto runDelta = [&](size_t budget) {
+        DeltaRun run;
+        clientRing.assign(SNAPSHOT_HISTORY, SnapshotState());
+        clientFood.clear();
+        clientFood.layout = FOOD_LAYOUT;
+        players.values[0].snapshots = SnapshotHistory();
+        players.values[0].entities = EntityTable();
+        players.values[0].foodSync = FoodSync();
+        waited.assign(PLAYERS, 0);
+        uint32_t resetEvent = 0;
+        for (int tick = 0; tick < DELTA_TICKS; tick++) {
+            for (int m = 0; m < PLAYERS / 10; m++) {
+                for (auto& cell : players.values[mover(benchGen)].cells) {
+                    cell.x += drift(benchGen);
+                    cell.y += drift(benchGen);
+                }
+            }
+            inView.clear();
+            food.grid.queryRect(WORLD_SIZE / 2 - VIEW_HALF_WIDTH, WORLD_SIZE / 2 - VIEW_HALF_HEIGHT,
+                WORLD_SIZE / 2 + VIEW_HALF_WIDTH, WORLD_SIZE / 2 + VIEW_HALF_HEIGHT, [&](const SpatialGrid::Entry& entry) {
+                    inView.push_back(food.ids[entry.slot]);
+                    return true;
+                });
+            for (int f = 0; f < FOOD_CHURN && !inView.empty(); f++) {
+                removeEatenFood(seeded, food, inView[benchGen() % inView.size()]);
+            }
+            if (tick % DROP_INTERVAL == 0) {
+                FoodDot dot = { nextFoodId++, onScreenX(benchGen), onScreenY(benchGen), 200, 180, 120 };
+                addDroppedFood(seeded, food, dot);
+            }
+            regrowFood(seeded, food);
+            buildBroadphase(players, broadphase);
+            buildLeaderboard(players, ranking, leaderboard);
+            ByteWriter writer(packet, sizeof(packet));
+            size_t length = encodeSnapshot(writer, players, 0, leaderboard, broadphase, seeded, visible,
+                visibleChunks, current, announcements, budget);
+            if (tick > 0) {
+                run.bytes += length;
+                run.largest = std::max(run.largest, length);
+            }
+
+            // Rebuild on the client side and check it matches what the server recorded
+            ByteReader reader(packet, length);
+            uint32_t sequence = 0, baselineSequence = 0;
+            readMessageHeader(reader);
+            peekSnapshotSequence(reader, sequence, baselineSequence);
+            const SnapshotState* baseline = baselineSequence ? &clientRing[baselineSequence % SNAPSHOT_HISTORY] : nullptr;
+            SnapshotState& rebuilt = clientRing[sequence % SNAPSHOT_HISTORY];
+            const SnapshotHistory& history = players.values[0].snapshots;
+            if (!decodeSnapshotDelta(reader, baseline, rebuilt, announcements, foodUpdate) ||
+                !sameSnapshot(rebuilt, history.sent[sequence % SNAPSHOT_HISTORY]) ||
+                !clientFood.apply(foodUpdate) ||
+                (clientFood.applied + 1 == players.values[0].foodSync.nextEvent() &&
+                    !sameFood(clientFood, players.values[0].foodSync, seeded, food)) ||
+                (foodUpdate.hasChecksum && !clientFood.matches(foodUpdate.checksum))) {
+                run.matches = false;
+            }
+            if (sequence > (uint32_t)ACK_LAG) acknowledgeSnapshot(players.values[0].snapshots, sequence - ACK_LAG);
+            const FoodSync& foodSync = players.values[0].foodSync;
+            if (tick > 0) run.foodBehind = std::max(run.foodBehind, foodSync.nextEvent() - 1 - clientFood.applied);
+            if (foodSync.resetEvent > resetEvent) run.foodResets++;
+            resetEvent = foodSync.resetEvent;
+
+            // A player waits while the client's copy of it differs from the server's
+            for (const SnapshotPlayer& player : current.players) {
+                const SnapshotPlayer* shown = findPlayer(rebuilt, player.id);
+                bool same = shown && shown->cellCount == player.cellCount &&
+                    std::equal(current.cellsOf(player), current.cellsOf(player) + player.cellCount,
+                        rebuilt.cellsOf(*shown), sameCell);
+                if (player.id >= waited.size()) waited.resize(player.id + 1, 0);
+                waited[player.id] = same ? 0 : waited[player.id] + 1;
+                if (tick > 0) run.longestWait = std::max(run.longestWait, waited[player.id]);
+            }
+        }
+        run.bytes /= (DELTA_TICKS - 1);
+        return run;
+    };
+
+    start = std::chrono::steady_clock::now();
+    DeltaRun delta = runDelta(sizeof(packet));
+    double deltaEncodeMs = elapsedMs(start, std::chrono::steady_clock::now());
+    DeltaRun budgeted = runDelta(SEND_BUDGET);
+
+    std::cout << "Snapshot protocol benchmark: " << PLAYERS << " players, "
+        << countFoodInView(decodedFood, viewer) << " food in view, " << ITERATIONS << " iterations" << std::endl;
+    std::cout << std::fixed << std::setprecision(2)
+        << std::setw(8) << "format" << std::setw(10) << "bytes" << std::setw(14) << "encode us"
+        << std::setw(14) << "decode us" << std::endl
+        << std::setw(8) << "text" << std::setw(10) << textBytes
+        << std::setw(14) << textEncodeMs * 1000.0 / ITERATIONS
+        << std::setw(14) << textDecodeMs * 1000.0 / ITERATIONS << std::endl
+        << std::setw(8) << "binary" << std::setw(10) << binaryBytes
+        << std::setw(14) << binaryEncodeMs * 1000.0 / ITERATIONS
+        << std::setw(14) << binaryDecodeMs * 1000.0 / ITERATIONS << std::endl
+        << std::setw(8) << "ratio" << std::setw(10) << (double)textBytes / binaryBytes
+        << std::setw(14) << textEncodeMs / binaryEncodeMs
+        << std::setw(14) << textDecodeMs / binaryDecodeMs
+        << ((textDecoded == binaryDecoded) ? "" : "   MISMATCH") << std::endl
+        << std::setw(8) << "delta" << std::setw(10) << delta.bytes
+        << std::setw(14) << deltaEncodeMs * 1000.0 / DELTA_TICKS
+        << std::setw(14) << "-"
+        << "   (" << PLAYERS / 10 << " players moving and " << FOOD_CHURN << " food eaten per tick, acks "
+        << ACK_LAG << " ticks late, "
+        << (double)binaryBytes / delta.bytes << "x smaller than full"
+        << (delta.matches ? ")" : ", MISMATCH)") << std::endl
+        << std::setw(8) << "budget" << std::setw(10) << budgeted.bytes
+        << std::setw(14) << "-" << std::setw(14) << "-"
+        << "   (" << SEND_BUDGET << " B per snapshot: largest " << budgeted.largest << " B, longest wait "
+        << budgeted.longestWait << " snapshots, " << delta.longestWait << " unbudgeted; food at most "
+        << budgeted.foodBehind << " events behind, " << budgeted.foodResets << " resets"
+        << (budgeted.matches ? ")" : ", MISMATCH)") << std::endl
+        << "per cell: text " << (double)textPlayerBytes / textCells << " B, binary "
+        << (double)binaryPlayerBytes / decoded.cells.size() << " B, plus "
+        << (double)metadataBytes / (announced ? announced : 1) << " B of metadata per player until acknowledged" << std::endl;
+
+    // Worst quantization error over the world and the size range, in pixels at the client's zoom
+    const float CLIENT_PIXEL_SCALE = 2.0f;  // WORLD_TO_PIXEL_SCALE in the client
+    std::uniform_real_distribution<float> worldPosition(0.0f, 10000.0f);
+    std::uniform_real_distribution<float> viewOffset(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> cellSize(CELL_SIZE_MIN, CELL_SIZE_MAX);
+    float positionError = 0.0f, sizeError = 0.0f;
+    for (int i = 0; i < 100000; i++) {
+        float origin = worldPosition(benchGen);
+        float value = origin + viewOffset(benchGen);
+        float error = std::fabs(dequantizePosition(quantizePositionNear(value, quantizePosition(origin))) - value);
+        if (error > positionError) positionError = error;
+
+        float size = cellSize(benchGen);
+        error = std::fabs(dequantizeSize(quantizeSize(size)) - size);
+        if (error > sizeError) sizeError = error;
+    }
+    std::cout << "quantized cell: " << 2 * POSITION_BITS + SIZE_BITS << " bits (96 as floats), max error "
+        << positionError * CLIENT_PIXEL_SCALE << " px position, " << sizeError * CLIENT_PIXEL_SCALE
+        << " px size" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout.precision(6);
+    FOOD_LAYOUT = savedLayout;
+}
+
+// Opens a non-blocking UDP socket on an ephemeral loopback port and fills addr with it
+SOCKET openLoopbackSocket(sockaddr_in6& addr) {
+    SOCKET sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET) return sock;
+    setNonBlocking(sock, true);
+    int bufferSize = 8 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (const char*)&bufferSize, sizeof(bufferSize));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_loopback;
+    socklen_t addrLen = sizeof(addr);
+    if (bind(sock, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        getsockname(sock, (sockaddr*)&addr, &addrLen) == SOCKET_ERROR) {
+        closeSocket(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// Loopback load test of the server's socket paths: one recvfrom / sendto per
+// datagram against receiveDatagrams / flushDatagrams. The load generator fills
+// the server socket's buffer with pongs, then only draining it is timed, so
+// the result is what one core can take in whatever else runs on the machine.
+// The send side pushes MTU-sized datagrams in tick-sized groups to a sink.
+void runIoBenchmark() {
+    const int ROUNDS = 200;
+    const int PACKETS_PER_ROUND = 2000;  // Fits a 4 MB receive buffer
+    const int SEND_DATAGRAMS = 200000;
+    const int DATAGRAMS_PER_TICK = 500;
+
+    if (!initSockets()) return;
+    sockaddr_in6 serverAddr, generatorAddr, sinkAddr;
+    SOCKET serverSocket = openLoopbackSocket(serverAddr);
+    SOCKET generatorSocket = openLoopbackSocket(generatorAddr);
+    SOCKET sinkSocket = openLoopbackSocket(sinkAddr);
+    if (serverSocket == INVALID_SOCKET || generatorSocket == INVALID_SOCKET || sinkSocket == INVALID_SOCKET) {
+        std::cerr << "I/O benchmark: could not open loopback sockets" << std::endl;
+        shutdownSockets();
+        return;
+    }
+
+    // One connected player, so every pong takes the full receive path
+    PlayerRegistry registry;
+    registry.players.init(1);
+    PlayerData player;
+    player.session = generateSessionId();
+    player.lastSeenAddr = generatorAddr;
+    addPlayer(registry, player);
+
+    uint8_t pong[64];
+    ByteWriter pongWriter(pong, sizeof(pong));
+    size_t pongLength = encodeSessionMessage(pongWriter, MSG_PONG, player.session);
+
+    ReceiveBatch incoming;
+    SendQueue load;
+    auto measureReceive = [&](bool batched) {
+        static uint8_t buffer[DATAGRAM_SLOT_SIZE];
+        size_t packets = 0;
+        double seconds = 0.0;
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int i = 0; i < PACKETS_PER_ROUND; i++) queueDatagram(load, pong, pongLength, serverAddr);
+            flushDatagrams(generatorSocket, load);
+
+            auto start = std::chrono::steady_clock::now();
+            while (true) {
+                if (batched) {
+                    int received = receiveDatagrams(serverSocket, incoming);
+                    if (received == 0) break;
+                    for (int i = 0; i < received; i++) {
+                        handleClientMessage(registry, INVALID_SOCKET, incoming.data(i), incoming.lengths[i], incoming.addresses[i]);
+                    }
+                    packets += received;
+                }
+                else {
+                    sockaddr_in6 clientAddr;
+                    socklen_t clientAddrLen = sizeof(clientAddr);
+                    int recvLen = recvfrom(serverSocket, (char*)buffer, sizeof(buffer), 0, (sockaddr*)&clientAddr, &clientAddrLen);
+                    if (recvLen == SOCKET_ERROR) break;
+                    handleClientMessage(registry, INVALID_SOCKET, buffer, recvLen, clientAddr);
+                    packets++;
+                }
+            }
+            seconds += elapsedMs(start, std::chrono::steady_clock::now()) / 1000.0;
+        }
+        return packets / seconds;
+    };
+
+    uint8_t snapshot[1200];
+    memset(snapshot, 0xAB, sizeof(snapshot));
+    SendQueue outgoing;
+    auto measureSend = [&](bool batched) {
+        int calls = 0;
+        double seconds = 0.0;
+        for (int sent = 0; sent < SEND_DATAGRAMS; sent += DATAGRAMS_PER_TICK) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < DATAGRAMS_PER_TICK; i++) {
+                if (batched) {
+                    queueDatagram(outgoing, snapshot, sizeof(snapshot), sinkAddr);
+                }
+                else {
+                    sendto(sinkSocket, (const char*)snapshot, (int)sizeof(snapshot), 0, (sockaddr*)&sinkAddr, sizeof(sinkAddr));
+                    calls++;
+                }
+            }
+            if (batched) calls += flushDatagrams(sinkSocket, outgoing);
+            seconds += elapsedMs(start, std::chrono::steady_clock::now()) / 1000.0;
+
+            while (receiveDatagrams(sinkSocket, incoming) > 0) {}  // Untimed, keeps the sink from dropping
+        }
+        return std::make_pair(SEND_DATAGRAMS / seconds, calls);
+    };
+
+    double receiveSingle = measureReceive(false);
+    double receiveBatched = measureReceive(true);
+    std::pair<double, int> sendSingle = measureSend(false);
+    std::pair<double, int> sendBatched = measureSend(true);
+
+#ifdef __linux__
+    const char* backend = "recvmmsg/sendmmsg";
+#else
+    const char* backend = "recvfrom/sendto loop";
+#endif
+    std::cout << "Datagram I/O benchmark: loopback, batched backend " << backend << std::endl;
+    std::cout << std::fixed << std::setprecision(0)
+        << std::setw(10) << "path" << std::setw(16) << "per datagram" << std::setw(16) << "batched"
+        << std::setw(10) << "ratio" << std::endl
+        << std::setw(10) << "receive" << std::setw(16) << receiveSingle << std::setw(16) << receiveBatched
+        << std::setw(10) << std::setprecision(2) << receiveBatched / receiveSingle << "   pkt/s on one core"
+        << std::endl
+        << std::setw(10) << "send" << std::setw(16) << std::setprecision(0) << sendSingle.first
+        << std::setw(16) << sendBatched.first << std::setw(10) << std::setprecision(2)
+        << sendBatched.first / sendSingle.first << "   pkt/s of " << sizeof(snapshot) << " B, "
+        << sendSingle.second << " vs " << sendBatched.second << " send calls" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout.precision(6);
+
+    closeSocket(serverSocket);
+    closeSocket(generatorSocket);
+    closeSocket(sinkSocket);
+    shutdownSockets();
+}
+
+// A seeded world for the tick benchmark: bots spread over the whole map with
+// the seeded food planted in full, every snapshot addressed to sinkAddr
+void buildBenchmarkWorld(SlotMap<PlayerData>& players, FoodStore& food,
+    SeededFood& seeded, int& nextFoodId, int playerCount, const sockaddr_in6& sinkAddr) {
+    gen.seed(2024);
+    auto now = std::chrono::steady_clock::now();
+    players.init(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        PlayerData player;
+        player.session = (uint64_t)i + 1;
+        player.name = "bot" + std::to_string(i);
+        respawnPlayer(player);
+        player.cells[0].size = randomFloat(PLAYER_START_SIZE, PLAYER_START_SIZE * 4.0f);
+        player.lastSeenAddr = sinkAddr;
+        player.lastInput = player.lastPingResponse = player.lastMovement = now;
+        player.lastSplit = player.lastMerge = now;
+        players.insert(player);
+    }
+
+    food.init((float)MAP_WIDTH, (float)MAP_HEIGHT, FOOD_SIZE * FOOD_GRID_CELL_FACTOR);
+    nextFoodId = DROPPED_FOOD_ID_BASE;
+    layoutSeededFood(2024);
+    initSeededFood(seeded);
+}
+
+// One bot's input for one tick of the tick benchmark
+struct ScriptedInput {
+    float heading;
+    bool split;
+    bool merge;
+};
+
+// Wandering bots that now and then split or merge, tick by tick
+void recordBenchmarkInputs(std::vector<ScriptedInput>& script, int playerCount, int ticks) {
+    std::mt19937 scriptGen(99);
+    std::uniform_real_distribution<float> turn(-0.3f, 0.3f);
+    std::uniform_int_distribution<int> action(0, 99);
+    std::vector<float> headings(playerCount);
+    for (float& heading : headings) heading = std::uniform_real_distribution<float>(0.0f, 6.28318f)(scriptGen);
+
+    script.clear();
+    for (int tick = 0; tick < ticks; tick++) {
+        for (int i = 0; i < playerCount; i++) {
+            headings[i] += turn(scriptGen);
+            int roll = action(scriptGen);
+            script.push_back({ headings[i], roll == 0, roll == 1 });
+        }
+    }
+}
+
+// Feeds one tick of the script to the bots. Split and merge cooldowns are
+// wall-clock based, so they are backdated to keep every run taking the same actions.
+void playBenchmarkInputs(SlotMap<PlayerData>& players, const ScriptedInput* inputs) {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < players.size(); i++) {
+        PlayerData& player = players.values[i];
+        player.inputX = cos(inputs[i].heading);
+        player.inputY = sin(inputs[i].heading);
+        player.lastInput = now;
+        player.pendingSplit = inputs[i].split;
+        player.pendingMerge = inputs[i].merge;
+        player.lastSplit = player.lastMerge = now - std::chrono::seconds(1);
+    }
+}
+
+// FNV-1a over every cell and food dot, in storage order
+uint64_t hashWorld(const SlotMap<PlayerData>& players, const FoodStore& food) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const void* data, size_t length) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < length; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    };
+    for (const PlayerData& player : players.values) {
+        uint32_t cellCount = (uint32_t)player.cells.size();
+        mix(&cellCount, sizeof(cellCount));
+        for (const Cell& cell : player.cells) {
+            mix(&cell.x, sizeof(cell.x));
+            mix(&cell.y, sizeof(cell.y));
+            mix(&cell.size, sizeof(cell.size));
+        }
+    }
+    for (size_t i = 0; i < food.size(); i++) {
+        float x = food.x((int)i);
+        float y = food.y((int)i);
+        mix(&food.ids[i], sizeof(int));
+        mix(&x, sizeof(float));
+        mix(&y, sizeof(float));
+    }
+    return hash;
+}
+
+// Tick time against simulation thread count for 1000 players and 100k food.
+// Every thread count plays the same recorded inputs from the same seeded
+// world and must end with the same world hash as the single-threaded run.
+// Input playback and food top-up between ticks are untimed; snapshots really
+// go out, to a loopback sink.
+void runTickBenchmark() {
+    const int PLAYERS = 1000;
+    const int FOOD = 100000;
+    const int WARMUP_TICKS = 5;
+    const int TICKS = 50;
+    const int ACK_LAG = 3;  // Ticks before a client's acknowledgement arrives
+    const int threadCounts[] = { 1, 2, 4, 8 };
+
+    if (!initSockets()) return;
+    sockaddr_in6 sinkAddr;
+    SOCKET sinkSocket = openLoopbackSocket(sinkAddr);
+    if (sinkSocket == INVALID_SOCKET) {
+        std::cerr << "Tick benchmark: could not open a loopback socket" << std::endl;
+        shutdownSockets();
+        return;
+    }
+    int savedMaxFood = MAX_FOOD;
+    MAX_FOOD = FOOD;
+
+    std::vector<ScriptedInput> script;
+    recordBenchmarkInputs(script, PLAYERS, WARMUP_TICKS + TICKS);
+
+    std::cout << "Tick benchmark: " << PLAYERS << " players, " << FOOD << " food, " << WORLD_REGIONS
+        << " regions, " << TICKS << " ticks, " << std::thread::hardware_concurrency()
+        << " hardware threads" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(10) << "tick" << std::setw(8) << "input"
+        << std::setw(8) << "move" << std::setw(8) << "food" << std::setw(8) << "cells"
+        << std::setw(8) << "send" << std::setw(10) << "KB sent" << std::setw(10) << "speedup"
+        << std::setw(18) << "world hash" << "   (per tick)" << std::endl;
+
+    SlotMap<PlayerData> players;
+    FoodStore food;
+    SeededFood seeded;
+    int nextFoodId = 0;
+    ReceiveBatch drained;
+    double singleThreadMs = 0.0;
+    uint64_t singleThreadHash = 0;
+    for (int threads : threadCounts) {
+        buildBenchmarkWorld(players, food, seeded, nextFoodId, PLAYERS, sinkAddr);
+        WorkStealingPool pool;
+        pool.start(threads);
+
+        TickStats stats;
+        for (int tick = 0; tick < WARMUP_TICKS + TICKS; tick++) {
+            if (tick == WARMUP_TICKS) stats = TickStats();
+            playBenchmarkInputs(players, &script[(size_t)tick * PLAYERS]);
+            regrowFood(seeded, food);
+
+            // Bots eating each other would flood the table with [EAT] lines
+            std::streambuf* console = std::cout.rdbuf(nullptr);
+            runTick(players, food, seeded, sinkSocket, pool, stats);
+            std::cout.rdbuf(console);
+            std::cout.clear();
+            while (receiveDatagrams(sinkSocket, drained) > 0) {}
+            for (size_t i = 0; i < players.size(); i++) {
+                SnapshotHistory& history = players.values[i].snapshots;
+                if (history.nextSequence > (uint32_t)ACK_LAG + 1) {
+                    acknowledgeSnapshot(history, history.nextSequence - 1 - ACK_LAG);
+                }
+            }
+        }
+
+        double tickMs = stats.totalMs / stats.ticks;
+        uint64_t hash = hashWorld(players, food);
+        if (threads == 1) {
+            singleThreadMs = tickMs;
+            singleThreadHash = hash;
+        }
+        std::cout << std::fixed << std::setprecision(2)
+            << std::setw(8) << threads << std::setw(10) << tickMs
+            << std::setw(8) << stats.inputMs / stats.ticks << std::setw(8) << stats.moveMs / stats.ticks
+            << std::setw(8) << stats.foodMs / stats.ticks << std::setw(8) << stats.cellsMs / stats.ticks
+            << std::setw(8) << stats.snapshotMs / stats.ticks
+            << std::setw(10) << stats.snapshotBytes / 1024.0 / stats.ticks << std::setw(10) << singleThreadMs / tickMs
+            << "  " << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec << std::setfill(' ')
+            << ((hash == singleThreadHash) ? "" : "   MISMATCH") << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout.precision(6);
+
+    MAX_FOOD = savedMaxFood;
+    closeSocket(sinkSocket);
+    shutdownSockets();
+}
+
+void runBenchmarks(const std::string& which) {
+    if (which.empty() || which == "food") runFoodBenchmark();
+    if (which.empty() || which == "protocol") runProtocolBenchmark();
+    if (which.empty() || which == "io") runIoBenchmark();
+    if (which.empty() || which == "tick") runTickBenchmark();
+}
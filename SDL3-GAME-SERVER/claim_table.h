@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// Lock-free arbitration between threads that want the same thing. Each
+// contender raises a slot to its bid with an atomic max, so once every bid is
+// in, the slot holds the highest one whatever order they arrived in. Bids must
+// be non-zero; 0 means unclaimed. Reading the winners is only meaningful after
+// all claiming threads have finished.
+struct ClaimTable {
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    size_t capacity = 0;
+
+    // Makes room for count slots. New slots start unclaimed; claimed ones must
+    // be released before the next round.
+    void reserve(size_t count) {
+        if (count <= capacity) return;
+        capacity = count + count / 2;
+        slots.reset(new std::atomic<uint64_t>[capacity]);
+        for (size_t i = 0; i < capacity; i++) slots[i].store(0, std::memory_order_relaxed);
+    }
+
+    void claim(size_t slot, uint64_t bid) {
+        uint64_t current = slots[slot].load(std::memory_order_relaxed);
+        while (bid > current && !slots[slot].compare_exchange_weak(current, bid, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t winner(size_t slot) const {
+        return slots[slot].load(std::memory_order_relaxed);
+    }
+
+    void release(size_t slot) {
+        slots[slot].store(0, std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,137 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include "socket_platform.h"
+
+// Datagram I/O in batches. On Linux one recvmmsg drains a whole batch and one
+// sendmmsg flushes a whole tick of snapshots; elsewhere the same calls fall
+// back to a recvfrom / sendto loop, so callers look the same everywhere.
+
+// Most datagrams one receiveDatagrams call picks up
+const int DATAGRAM_BATCH = 64;
+// Biggest datagram a client sends; anything longer is truncated and fails to parse
+const size_t DATAGRAM_SLOT_SIZE = 4096;
+// sendmmsg takes at most this many datagrams per call (UIO_MAXIOV)
+const size_t SEND_BATCH_LIMIT = 1024;
+
+struct ReceiveBatch {
+    std::vector<uint8_t> storage = std::vector<uint8_t>(DATAGRAM_BATCH * DATAGRAM_SLOT_SIZE);
+    int count = 0;
+    int lengths[DATAGRAM_BATCH];
+    sockaddr_in6 addresses[DATAGRAM_BATCH];
+#ifdef __linux__
+    mmsghdr headers[DATAGRAM_BATCH];
+    iovec vectors[DATAGRAM_BATCH];
+#endif
+
+    const uint8_t* data(int i) const {
+        return storage.data() + i * DATAGRAM_SLOT_SIZE;
+    }
+};
+
+// Reads up to DATAGRAM_BATCH waiting datagrams without blocking. Returns how
+// many arrived; 0 when the socket is empty.
+inline int receiveDatagrams(SOCKET socket, ReceiveBatch& batch) {
+    batch.count = 0;
+#ifdef __linux__
+    memset(batch.headers, 0, sizeof(batch.headers));
+    for (int i = 0; i < DATAGRAM_BATCH; i++) {
+        batch.vectors[i].iov_base = batch.storage.data() + i * DATAGRAM_SLOT_SIZE;
+        batch.vectors[i].iov_len = DATAGRAM_SLOT_SIZE;
+        batch.headers[i].msg_hdr.msg_iov = &batch.vectors[i];
+        batch.headers[i].msg_hdr.msg_iovlen = 1;
+        batch.headers[i].msg_hdr.msg_name = &batch.addresses[i];
+        batch.headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in6);
+    }
+    int received = recvmmsg(socket, batch.headers, DATAGRAM_BATCH, MSG_DONTWAIT, nullptr);
+    for (int i = 0; i < received; i++) {
+        batch.lengths[i] = (int)batch.headers[i].msg_len;
+    }
+    batch.count = (received > 0) ? received : 0;
+#else
+    // Windows reports an ICMP "port unreachable" from an earlier send as an
+    // error on the next receive, so errors other than "empty" are skipped
+    for (int attempt = 0; attempt < DATAGRAM_BATCH; attempt++) {
+        socklen_t addrLen = sizeof(sockaddr_in6);
+        int length = recvfrom(socket, (char*)batch.storage.data() + batch.count * DATAGRAM_SLOT_SIZE,
+            (int)DATAGRAM_SLOT_SIZE, 0, (sockaddr*)&batch.addresses[batch.count], &addrLen);
+        if (length == SOCKET_ERROR) {
+            if (socketWouldBlock()) break;
+            continue;
+        }
+        batch.lengths[batch.count++] = length;
+    }
+#endif
+    return batch.count;
+}
+
+// Datagrams waiting to go out, packed back to back. The vectors keep their
+// capacity across flushes, so after the first busy tick queueing allocates nothing.
+struct SendQueue {
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> offsets;
+    std::vector<size_t> lengths;
+    std::vector<sockaddr_in6> addresses;
+#ifdef __linux__
+    std::vector<mmsghdr> headers;
+    std::vector<iovec> vectors;
+#endif
+
+    size_t size() const {
+        return lengths.size();
+    }
+
+    void clear() {
+        bytes.clear();
+        offsets.clear();
+        lengths.clear();
+        addresses.clear();
+    }
+};
+
+inline void queueDatagram(SendQueue& queue, const uint8_t* data, size_t length, const sockaddr_in6& addr) {
+    if (length == 0) return;
+    queue.offsets.push_back(queue.bytes.size());
+    queue.lengths.push_back(length);
+    queue.addresses.push_back(addr);
+    queue.bytes.insert(queue.bytes.end(), data, data + length);
+}
+
+// Sends and empties the queue. Returns the number of send calls it took: one
+// per SEND_BATCH_LIMIT datagrams on Linux, one per datagram elsewhere. A
+// datagram the socket refuses (full buffer, unreachable) is dropped, as UDP would.
+inline int flushDatagrams(SOCKET socket, SendQueue& queue) {
+    size_t count = queue.size();
+    int calls = 0;
+#ifdef __linux__
+    // Pointers into bytes are only stable once queueing is done
+    queue.headers.resize(count);
+    queue.vectors.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        queue.vectors[i].iov_base = queue.bytes.data() + queue.offsets[i];
+        queue.vectors[i].iov_len = queue.lengths[i];
+        memset(&queue.headers[i], 0, sizeof(mmsghdr));
+        queue.headers[i].msg_hdr.msg_iov = &queue.vectors[i];
+        queue.headers[i].msg_hdr.msg_iovlen = 1;
+        queue.headers[i].msg_hdr.msg_name = &queue.addresses[i];
+        queue.headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in6);
+    }
+    size_t sent = 0;
+    while (sent < count) {
+        size_t batch = (count - sent < SEND_BATCH_LIMIT) ? count - sent : SEND_BATCH_LIMIT;
+        int result = sendmmsg(socket, queue.headers.data() + sent, (unsigned int)batch, 0);
+        calls++;
+        // sendmmsg stops at the first datagram that fails; skip it and carry on
+        sent += (result > 0) ? (size_t)result : 1;
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        sendto(socket, (const char*)queue.bytes.data() + queue.offsets[i], (int)queue.lengths[i], 0,
+            (const sockaddr*)&queue.addresses[i], sizeof(sockaddr_in6));
+        calls++;
+    }
+#endif
+    queue.clear();
+    return calls;
+}
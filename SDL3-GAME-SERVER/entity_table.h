@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "snapshot_delta.h"
+
+// Per-connection entity ids for the players one client has been shown.
+// Snapshots refer to players by these small ids instead of their server-wide
+// handles. A player's metadata is announced from the first snapshot that
+// needs it until the client acknowledges one of those snapshots.
+//
+// Ids of players that left are held back for SNAPSHOT_HISTORY snapshots before
+// reuse, so no baseline the client could still be asked to use mentions them.
+struct EntityTable {
+    static const uint32_t NO_PLAYER = 0xFFFFFFFFu;
+
+    struct Entry {
+        uint32_t playerId = NO_PLAYER;  // Server-wide handle, NO_PLAYER while free
+        uint32_t announcedIn = 0;       // First snapshot that carried the metadata
+        uint32_t releasedIn = 0;        // Snapshot at which the player was found gone
+        bool confirmed = false;
+    };
+
+    std::unordered_map<uint32_t, uint16_t> idOf;
+    std::vector<Entry> entries;
+    std::vector<uint16_t> freeIds;
+    std::vector<uint16_t> pending;  // Ids whose metadata is not confirmed yet
+    std::vector<float> priority;    // Per id: send priority, see encodeSnapshotDelta
+
+    // The id for a player, assigned on first sight
+    uint16_t idFor(uint32_t playerId) {
+        auto it = idOf.find(playerId);
+        if (it != idOf.end()) return it->second;
+
+        uint16_t id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        }
+        else {
+            id = (uint16_t)entries.size();
+            entries.push_back(Entry());
+            priority.push_back(0.0f);
+        }
+        entries[id] = Entry();
+        priority[id] = 0.0f;
+        entries[id].playerId = playerId;
+        idOf[playerId] = id;
+        pending.push_back(id);
+        return id;
+    }
+
+    // Fills announcements for snapshot sequence. describe(playerId, info)
+    // fills name and color and returns false for players that are gone.
+    template<typename Describe>
+    void collectAnnouncements(uint32_t sequence, uint32_t ackedSequence,
+        std::vector<EntityInfo>& announcements, Describe describe) {
+        announcements.clear();
+        size_t kept = 0;
+        for (uint16_t id : pending) {
+            Entry& entry = entries[id];
+            if (entry.playerId == NO_PLAYER) continue;
+            if (entry.announcedIn != 0 && ackedSequence >= entry.announcedIn) {
+                entry.confirmed = true;
+                continue;
+            }
+
+            EntityInfo info;
+            info.id = id;
+            info.playerId = entry.playerId;
+            if (!describe(entry.playerId, info)) continue;
+            if (entry.announcedIn == 0) entry.announcedIn = sequence;
+            announcements.push_back(info);
+            pending[kept++] = id;
+        }
+        pending.resize(kept);
+    }
+
+    // Marks ids of players that are gone and frees the ones released long
+    // enough ago. isAlive(playerId) reports whether the player still exists.
+    template<typename IsAlive>
+    void sweep(uint32_t sequence, IsAlive isAlive) {
+        for (size_t id = 0; id < entries.size(); id++) {
+            Entry& entry = entries[id];
+            if (entry.playerId == NO_PLAYER) continue;
+
+            if (entry.releasedIn == 0) {
+                if (!isAlive(entry.playerId)) entry.releasedIn = sequence;
+            }
+            else if (sequence - entry.releasedIn >= SNAPSHOT_HISTORY) {
+                idOf.erase(entry.playerId);
+                entry.playerId = NO_PLAYER;
+                freeIds.push_back((uint16_t)id);
+            }
+        }
+    }
+};
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FOOD_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FOOD_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define FOOD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Squared-distance kernels over structure-of-arrays positions. Each writes the
+// indices i where (xs[i] - x)^2 + (ys[i] - y)^2 < radiusSq into out and returns
+// how many it wrote; out must hold at least count entries.
+typedef int (*WithinRadiusKernel)(const float* xs, const float* ys, int count,
+    float x, float y, float radiusSq, int* out);
+
+inline int withinRadiusTail(const float* xs, const float* ys, int start, int count,
+    float x, float y, float radiusSq, int* out, int found) {
+    for (int i = start; i < count; i++) {
+        float dx = xs[i] - x;
+        float dy = ys[i] - y;
+        if (dx * dx + dy * dy < radiusSq) out[found++] = i;
+    }
+    return found;
+}
+
+inline int withinRadiusScalar(const float* xs, const float* ys, int count,
+    float x, float y, float radiusSq, int* out) {
+    return withinRadiusTail(xs, ys, 0, count, x, y, radiusSq, out, 0);
+}
+
+#ifdef FOOD_KERNELS_X86
+inline int withinRadiusSSE2(const float* xs, const float* ys, int count,
+    float x, float y, float radiusSq, int* out) {
+    __m128 cx = _mm_set1_ps(x);
+    __m128 cy = _mm_set1_ps(y);
+    __m128 limit = _mm_set1_ps(radiusSq);
+    int found = 0;
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), cx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), cy);
+        __m128 distSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(distSq, limit));
+        for (int bit = 0; mask; bit++, mask >>= 1) {
+            if (mask & 1) out[found++] = i + bit;
+        }
+    }
+
+    return withinRadiusTail(xs, ys, i, count, x, y, radiusSq, out, found);
+}
+
+FOOD_TARGET_AVX2 inline int withinRadiusAVX2(const float* xs, const float* ys, int count,
+    float x, float y, float radiusSq, int* out) {
+    __m256 cx = _mm256_set1_ps(x);
+    __m256 cy = _mm256_set1_ps(y);
+    __m256 limit = _mm256_set1_ps(radiusSq);
+    int found = 0;
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), cy);
+        __m256 distSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(distSq, limit, _CMP_LT_OQ));
+        for (int bit = 0; mask; bit++, mask >>= 1) {
+            if (mask & 1) out[found++] = i + bit;
+        }
+    }
+
+    return withinRadiusTail(xs, ys, i, count, x, y, radiusSq, out, found);
+}
+
+inline bool cpuSupportsSSE2() {
+#if defined(_M_X64) || defined(__x86_64__)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    return (edx & (1u << 26)) != 0;
+#endif
+}
+
+inline bool cpuSupportsAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    // The OS must save the YMM registers on context switch
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+struct WithinRadiusSelection {
+    WithinRadiusKernel kernel;
+    const char* name;
+};
+
+// Picks the widest kernel the running CPU supports; chosen once, on first use
+inline const WithinRadiusSelection& withinRadiusSelection() {
+    static const WithinRadiusSelection selection = []() {
+#ifdef FOOD_KERNELS_X86
+        if (cpuSupportsAVX2()) return WithinRadiusSelection{ withinRadiusAVX2, "AVX2" };
+        if (cpuSupportsSSE2()) return WithinRadiusSelection{ withinRadiusSSE2, "SSE2" };
+#endif
+        return WithinRadiusSelection{ withinRadiusScalar, "scalar" };
+    }();
+    return selection;
+}
+
+inline int withinRadius(const float* xs, const float* ys, int count,
+    float x, float y, float radiusSq, int* out) {
+    return withinRadiusSelection().kernel(xs, ys, count, x, y, radiusSq, out);
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "spatial_grid.h"
+
+struct FoodDot {
+    int id;
+    float x;
+    float y;
+    uint8_t r, g, b;
+};
+
+// The one store of record for food. Positions live only in the spatial grid's
+// structure-of-arrays buckets, where the distance kernels stream through them;
+// everything else is indexed by a dense slot that the grid entries carry.
+// Removal swaps the last dot into the hole, so slots stay dense while slotOf
+// keeps each dot's id stable for clients.
+struct FoodStore {
+    SpatialGrid grid;
+    std::vector<int> ids;
+    std::vector<uint32_t> colors;  // 0x00RRGGBB
+    std::vector<SpatialGrid::Location> locations;
+    std::unordered_map<int, int> slotOf;
+
+    void init(float width, float height, float cellSize) {
+        grid.init(width, height, cellSize);
+        ids.clear();
+        colors.clear();
+        locations.clear();
+        slotOf.clear();
+    }
+
+    std::size_t size() const {
+        return ids.size();
+    }
+
+    void reserve(std::size_t capacity) {
+        ids.reserve(capacity);
+        colors.reserve(capacity);
+        locations.reserve(capacity);
+        slotOf.reserve(capacity);
+    }
+
+    void add(const FoodDot& dot) {
+        int slot = (int)ids.size();
+        slotOf[dot.id] = slot;
+        ids.push_back(dot.id);
+        colors.push_back(((uint32_t)dot.r << 16) | ((uint32_t)dot.g << 8) | dot.b);
+        locations.push_back(grid.insert(slot, dot.x, dot.y));
+    }
+
+    // Slot of the given id, or -1 if it is not stored
+    int find(int id) const {
+        auto it = slotOf.find(id);
+        return (it == slotOf.end()) ? -1 : it->second;
+    }
+
+    float x(int slot) const {
+        return grid.xAt(locations[slot]);
+    }
+
+    float y(int slot) const {
+        return grid.yAt(locations[slot]);
+    }
+
+    bool remove(int id) {
+        auto it = slotOf.find(id);
+        if (it == slotOf.end()) return false;
+
+        int slot = it->second;
+        int moved = grid.remove(locations[slot]);
+        if (moved >= 0) locations[moved] = locations[slot];
+
+        int last = (int)ids.size() - 1;
+        if (slot != last) {
+            ids[slot] = ids[last];
+            colors[slot] = colors[last];
+            locations[slot] = locations[last];
+            grid.setSlot(locations[slot], slot);
+            slotOf[ids[slot]] = slot;
+        }
+        ids.pop_back();
+        colors.pop_back();
+        locations.pop_back();
+        slotOf.erase(it);
+        return true;
+    }
+
+    FoodDot get(int slot) const {
+        FoodDot dot;
+        dot.id = ids[slot];
+        dot.x = x(slot);
+        dot.y = y(slot);
+        dot.r = (uint8_t)(colors[slot] >> 16);
+        dot.g = (uint8_t)(colors[slot] >> 8);
+        dot.b = (uint8_t)colors[slot];
+        return dot;
+    }
+};
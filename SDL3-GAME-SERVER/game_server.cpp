@@ -0,0 +1,1418 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include "game_server.h"
+
+// Configuration variables (loaded from file)
+int MAP_WIDTH = 10000;
+int MAP_HEIGHT = 10000;
+int MAX_PLAYERS = 50;
+std::string SERVER_NAME = "A Blob Game Server!";
+std::string SERVER_CODE = "";  // Optional join code
+float FOOD_PERCENTAGE = 0.01f;
+int FOOD_SPAWN_PER_TICK = 2;
+int PING_TIMEOUT_SECONDS = 30;
+int INACTIVITY_TIMEOUT_SECONDS = 600;
+float MOVE_SPEED_BASE = 10.0f;
+float GROWTH_RATE_FOOD = 0.02f;
+float GROWTH_RATE_PLAYER = 0.04f;
+float PLAYER_START_SIZE_PERCENTAGE = 0.002f;
+float PLAYER_MAX_SIZE_PERCENTAGE = 0.02f;
+int GAME_SERVER_PORT = 8888;
+int TICK_RATE = 20;
+int MTU = 1200;
+int SEND_RATE = 64000;
+int SEND_PACKET_BYTES = 4800;
+int SIM_THREADS = 0;
+int WORLD_REGIONS = 16;
+uint64_t WORLD_SEED = 0;
+int MAX_FOOD = 500;
+FoodLayout FOOD_LAYOUT;
+float PLAYER_START_SIZE = 20.0f;
+float MIN_PLAYER_SIZE = 10.0f;
+float MAX_PLAYER_SIZE = 200.0f;
+float FOOD_SIZE = 5.0f;
+
+std::random_device rd;
+std::mt19937 gen(rd());
+
+AddressKey makeAddressKey(const sockaddr_in6& addr) {
+    AddressKey key;
+    memcpy(key.bytes, &addr.sin6_addr, sizeof(key.bytes));
+    key.port = addr.sin6_port;
+    return key;
+}
+
+// Splits MAX_FOOD evenly over the chunks of the map. The split is approximate:
+// each whole chunk's share is rounded up, and is at least one dot, so a small
+// MAX_FOOD on a big map still leaves food everywhere.
+void layoutSeededFood(uint64_t seed) {
+    FOOD_LAYOUT.init(seed, (uint32_t)MAP_WIDTH, (uint32_t)MAP_HEIGHT, FOOD_CHUNK_SIZE, 0);
+    uint64_t chunkArea = (uint64_t)FOOD_LAYOUT.chunkSize * FOOD_LAYOUT.chunkSize;
+    uint64_t mapArea = (uint64_t)MAP_WIDTH * MAP_HEIGHT;
+    uint64_t perChunk = ((uint64_t)MAX_FOOD * chunkArea + mapArea - 1) / mapArea;
+    FOOD_LAYOUT.perChunk = (uint32_t)std::min<uint64_t>(std::max<uint64_t>(perChunk, 1), MAX_FOOD_PER_CHUNK);
+}
+
+void calculateGameSizes() {
+    int smallestDimension = (MAP_WIDTH < MAP_HEIGHT) ? MAP_WIDTH : MAP_HEIGHT;
+    PLAYER_START_SIZE = smallestDimension * PLAYER_START_SIZE_PERCENTAGE;
+    MAX_PLAYER_SIZE = smallestDimension * PLAYER_MAX_SIZE_PERCENTAGE;
+    // Snapshots quantize sizes up to CELL_SIZE_MAX, so bigger cells could not be drawn
+    // at their real size; on maps wider than about 51200 the cap is this instead.
+    if (MAX_PLAYER_SIZE > CELL_SIZE_MAX) MAX_PLAYER_SIZE = CELL_SIZE_MAX;
+    MIN_PLAYER_SIZE = PLAYER_START_SIZE * 0.5f;
+    FOOD_SIZE = PLAYER_START_SIZE * 0.25f;
+    float mapArea = MAP_WIDTH * MAP_HEIGHT;
+    float foodArea = 3.14159f * FOOD_SIZE * FOOD_SIZE;
+    MAX_FOOD = (int)((mapArea * FOOD_PERCENTAGE) / foodArea);
+    if (MAX_FOOD < 10) MAX_FOOD = 10;
+    layoutSeededFood(WORLD_SEED);
+}
+
+bool loadConfig() {
+    std::ifstream configFile("server_config.txt");
+
+    if (!configFile.is_open()) {
+        std::ofstream newConfig("server_config.txt");
+        newConfig << "# Blob Game Server Configuration\n";
+        newConfig << "# Edit values below and restart the server\n\n";
+        newConfig << "SERVER_NAME=A Blob Game Server\n";
+        newConfig << "SERVER_CODE=\n";
+        newConfig << "GAME_SERVER_PORT=8888\n";
+        newConfig << "MAP_WIDTH=10000\n";
+        newConfig << "MAP_HEIGHT=10000\n";
+        newConfig << "MAX_PLAYERS=50\n\n";
+        newConfig << "# Simulation rate: World steps per second\n";
+        newConfig << "TICK_RATE=20\n\n";
+        newConfig << "# Largest UDP datagram the server sends; larger snapshots are split into fragments\n";
+        newConfig << "MTU=1200\n\n";
+        newConfig << "# Per-client send budget: average bytes per second, and the most one snapshot may use\n";
+        newConfig << "SEND_RATE=64000\n";
+        newConfig << "SEND_PACKET_BYTES=4800\n\n";
+        newConfig << "# Simulation threads (0 = one per CPU thread) and map strips simulated in parallel\n";
+        newConfig << "SIM_THREADS=0\n";
+        newConfig << "WORLD_REGIONS=16\n\n";
+        newConfig << "# Food percentage: How much of the map can be covered with food (0.01 = 1%, 0.5 = 50%)\n";
+        newConfig << "FOOD_PERCENTAGE=0.05\n";
+        newConfig << "FOOD_SPAWN_PER_TICK=2\n";
+        newConfig << "# Seed for the food layout, which clients regenerate themselves (0 = random at every start)\n";
+        newConfig << "WORLD_SEED=0\n\n";
+        newConfig << "# Player size scaling: Percentage of smallest map dimension (max size is capped at 1024)\n";
+        newConfig << "PLAYER_START_SIZE_PERCENTAGE=0.002\n";
+        newConfig << "PLAYER_MAX_SIZE_PERCENTAGE=0.02\n\n";
+        newConfig << "# Timeout settings\n";
+        newConfig << "PING_TIMEOUT_SECONDS=30\n";
+        newConfig << "INACTIVITY_TIMEOUT_SECONDS=600\n\n";
+        newConfig << "MOVE_SPEED_BASE=10\n\n";
+        newConfig << "# Growth rates: Constant growth (does not scale with player size)\n";
+        newConfig << "GROWTH_RATE_FOOD=0.04\n";
+        newConfig << "GROWTH_RATE_PLAYER=0.04\n";
+        newConfig.close();
+
+        std::cout << "==================================================" << std::endl;
+        std::cout << "CONFIG FILE CREATED: server_config.txt" << std::endl;
+        std::cout << "==================================================" << std::endl;
+        std::cout << "Please edit the configuration file and restart the server." << std::endl;
+        std::cout << "\nPress any key to exit..." << std::endl;
+        std::cin.get();
+        return false;
+    }
+
+    std::string line;
+    int lineNum = 0;
+    while (std::getline(configFile, line)) {
+        lineNum++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        size_t pos = line.find('=');
+        if (pos == std::string::npos) continue;
+        std::string key = trim(line.substr(0, pos));
+        std::string value = trim(line.substr(pos + 1));
+
+        try {
+            if (key == "SERVER_NAME") SERVER_NAME = value;
+            else if (key == "SERVER_CODE") SERVER_CODE = value;
+            else if (key == "GAME_SERVER_PORT") GAME_SERVER_PORT = std::stoi(value);
+            else if (key == "MAP_WIDTH") MAP_WIDTH = std::stoi(value);
+            else if (key == "MAP_HEIGHT") MAP_HEIGHT = std::stoi(value);
+            else if (key == "MAX_PLAYERS") MAX_PLAYERS = std::stoi(value);
+            else if (key == "FOOD_PERCENTAGE") FOOD_PERCENTAGE = std::stof(value);
+            else if (key == "FOOD_SPAWN_PER_TICK") FOOD_SPAWN_PER_TICK = std::stoi(value);
+            else if (key == "WORLD_SEED") WORLD_SEED = std::stoull(value);
+            else if (key == "PLAYER_START_SIZE_PERCENTAGE") PLAYER_START_SIZE_PERCENTAGE = std::stof(value);
+            else if (key == "PLAYER_MAX_SIZE_PERCENTAGE") PLAYER_MAX_SIZE_PERCENTAGE = std::stof(value);
+            else if (key == "PING_TIMEOUT_SECONDS") PING_TIMEOUT_SECONDS = std::stoi(value);
+            else if (key == "INACTIVITY_TIMEOUT_SECONDS") INACTIVITY_TIMEOUT_SECONDS = std::stoi(value);
+            else if (key == "MOVE_SPEED_BASE") MOVE_SPEED_BASE = std::stof(value);
+            else if (key == "GROWTH_RATE_FOOD") GROWTH_RATE_FOOD = std::stof(value);
+            else if (key == "GROWTH_RATE_PLAYER") GROWTH_RATE_PLAYER = std::stof(value);
+            else if (key == "TICK_RATE") TICK_RATE = std::stoi(value);
+            else if (key == "MTU") MTU = std::stoi(value);
+            else if (key == "SEND_RATE") SEND_RATE = std::stoi(value);
+            else if (key == "SEND_PACKET_BYTES") SEND_PACKET_BYTES = std::stoi(value);
+            else if (key == "SIM_THREADS") SIM_THREADS = std::stoi(value);
+            else if (key == "WORLD_REGIONS") WORLD_REGIONS = std::stoi(value);
+        }
+        catch (const std::exception& e) {
+            std::cout << "Error parsing line " << lineNum << std::endl;
+        }
+    }
+
+    configFile.close();
+    if (TICK_RATE < 1) TICK_RATE = 1;
+    if (TICK_RATE > 240) TICK_RATE = 240;
+    if (MTU < 256) MTU = 256;
+    if (MTU > (int)MAX_PACKET_SIZE) MTU = (int)MAX_PACKET_SIZE;
+    if (SEND_PACKET_BYTES < (int)MIN_SNAPSHOT_BUDGET) SEND_PACKET_BYTES = (int)MIN_SNAPSHOT_BUDGET;
+    if (SEND_RATE < TICK_RATE * (int)MIN_SNAPSHOT_CREDIT) SEND_RATE = TICK_RATE * (int)MIN_SNAPSHOT_CREDIT;
+    if (SIM_THREADS < 0) SIM_THREADS = 0;
+    if (WORLD_REGIONS < 1) WORLD_REGIONS = 1;
+    if (WORLD_REGIONS > 256) WORLD_REGIONS = 256;
+    if (WORLD_SEED == 0) WORLD_SEED = ((uint64_t)rd() << 32) | rd();
+    calculateGameSizes();
+    return true;
+}
+
+void sendMessage(SOCKET serverSocket, const uint8_t* packet, size_t length, const sockaddr_in6& addr) {
+    if (length == 0) return;
+    sendto(serverSocket, (const char*)packet, (int)length, 0, (sockaddr*)&addr, sizeof(addr));
+}
+
+// Bytes of a message that fit in one MSG_FRAGMENT at the configured MTU
+size_t fragmentPayloadSize() {
+    return (size_t)MTU - MESSAGE_HEADER_SIZE - FRAGMENT_HEADER_SIZE;
+}
+
+// Largest snapshot worth encoding: what MAX_FRAGMENTS pieces can carry
+size_t snapshotCapacity() {
+    size_t capacity = fragmentPayloadSize() * MAX_FRAGMENTS;
+    return (capacity < MAX_PACKET_SIZE) ? capacity : MAX_PACKET_SIZE;
+}
+
+// Queues a message as is when it fits the MTU, otherwise as MSG_FRAGMENT
+// pieces tagged with messageId. Returns the number of datagrams queued.
+int sendFragmented(SendQueue& outgoing, const uint8_t* packet, size_t length, uint32_t messageId,
+    const sockaddr_in6& addr) {
+    if (length == 0) return 0;
+    if (length <= (size_t)MTU) {
+        queueDatagram(outgoing, packet, length, addr);
+        return 1;
+    }
+
+    static thread_local uint8_t fragment[MAX_PACKET_SIZE];
+    size_t pieceSize = fragmentPayloadSize();
+    int count = (int)((length + pieceSize - 1) / pieceSize);
+    for (int i = 0; i < count; i++) {
+        size_t offset = i * pieceSize;
+        size_t pieceLength = (length - offset < pieceSize) ? length - offset : pieceSize;
+        FragmentHeader header = { messageId, (uint8_t)i, (uint8_t)count, (uint16_t)offset };
+        ByteWriter writer(fragment, sizeof(fragment));
+        queueDatagram(outgoing, fragment, encodeFragment(writer, header, packet + offset, pieceLength), addr);
+    }
+    return count;
+}
+
+void registerWithServerFinder(int currentPlayers) {
+    static SOCKET finderSocket = INVALID_SOCKET;
+    static sockaddr_in6 finderAddr;
+    static bool initialized = false;
+
+    if (!initialized) {
+        finderSocket = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+        if (finderSocket == INVALID_SOCKET) return;
+
+        memset(&finderAddr, 0, sizeof(finderAddr));
+        finderAddr.sin6_family = AF_INET6;
+        finderAddr.sin6_port = htons(SERVER_FINDER_PORT_NUM);
+        inet_pton(AF_INET6, SERVER_FINDER_IP_ADDR.c_str(), &finderAddr.sin6_addr);
+        initialized = true;
+    }
+
+    ServerInfo info;
+    info.name = SERVER_NAME;
+    info.port = GAME_SERVER_PORT;
+    info.currentPlayers = currentPlayers;
+    info.maxPlayers = MAX_PLAYERS;
+    info.mapWidth = MAP_WIDTH;
+    info.mapHeight = MAP_HEIGHT;
+    info.hasPassword = !SERVER_CODE.empty();
+    info.serverCode = SERVER_CODE;
+
+    uint8_t packet[512];
+    ByteWriter writer(packet, sizeof(packet));
+    sendMessage(finderSocket, packet, encodeRegister(writer, info), finderAddr);
+}
+
+// Random, non-zero: zero means "no session" on the wire
+uint64_t generateSessionId() {
+    std::uniform_int_distribution<uint64_t> dis(1, UINT64_MAX);
+    return dis(gen);
+}
+
+void generatePlayerColor(uint8_t& r, uint8_t& g, uint8_t& b) {
+    std::uniform_int_distribution<int> colorChoice(0, 11);
+    int choice = colorChoice(gen);
+    switch (choice) {
+    case 0:  r = 255; g = 100; b = 100; break;
+    case 1:  r = 100; g = 255; b = 100; break;
+    case 2:  r = 100; g = 100; b = 255; break;
+    case 3:  r = 255; g = 255; b = 100; break;
+    case 4:  r = 255; g = 100; b = 255; break;
+    case 5:  r = 100; g = 255; b = 255; break;
+    case 6:  r = 255; g = 150; b = 100; break;
+    case 7:  r = 150; g = 100; b = 255; break;
+    case 8:  r = 255; g = 100; b = 150; break;
+    case 9:  r = 150; g = 255; b = 100; break;
+    case 10: r = 100; g = 150; b = 255; break;
+    case 11: r = 255; g = 200; b = 100; break;
+    }
+}
+
+float randomFloat(float min, float max) {
+    std::uniform_real_distribution<float> dist(min, max);
+    return dist(gen);
+}
+
+void respawnPlayer(PlayerData& player) {
+    player.cells.clear();
+    Cell startCell;
+    startCell.x = randomFloat(10, MAP_WIDTH - 10);
+    startCell.y = randomFloat(10, MAP_HEIGHT - 10);
+    startCell.size = PLAYER_START_SIZE;
+    player.cells.push_back(startCell);
+    generatePlayerColor(player.colorR, player.colorG, player.colorB);
+}
+
+void initSeededFood(SeededFood& seeded) {
+    seeded.chunks.assign(FOOD_LAYOUT.chunkCount(), FoodChunk());
+    seeded.neededAt.assign(FOOD_LAYOUT.chunkCount(), 0);
+    seeded.planted.clear();
+    seeded.eaten.clear();
+    seeded.tick = 0;
+    seeded.regrowBudget = 0;
+}
+
+int seededFoodId(uint32_t chunk, uint32_t slot) {
+    return (int)((chunk << FOOD_SLOT_BITS) | slot);
+}
+
+// Adds the uneaten dots of the chunk's current generation to the food store
+void plantChunk(SeededFood& seeded, uint32_t chunk, FoodStore& food) {
+    static std::vector<uint8_t> eaten;
+    const FoodChunk& state = seeded.chunks[chunk];
+    uint32_t slots = FOOD_LAYOUT.slotsIn(chunk);
+    eaten.assign(slots, 0);
+    for (uint16_t slot : state.eatOrder) eaten[slot] = 1;
+    for (uint32_t slot = 0; slot < slots; slot++) {
+        if (eaten[slot]) continue;
+        SeededDot dot = FOOD_LAYOUT.dot(chunk, state.generation, slot);
+        FoodDot newFood;
+        newFood.id = seededFoodId(chunk, slot);
+        newFood.x = dequantizePosition(dot.x);
+        newFood.y = dequantizePosition(dot.y);
+        newFood.r = (uint8_t)(dot.color >> 16);
+        newFood.g = (uint8_t)(dot.color >> 8);
+        newFood.b = (uint8_t)dot.color;
+        food.add(newFood);
+    }
+    seeded.neededAt[chunk] = seeded.tick + 1;
+    seeded.planted.push_back(chunk);
+}
+
+// Takes the chunk's seeded dots back out of the food store
+void unplantChunk(SeededFood& seeded, uint32_t chunk, FoodStore& food) {
+    uint32_t slots = FOOD_LAYOUT.slotsIn(chunk);
+    for (uint32_t slot = 0; slot < slots; slot++) food.remove(seededFoodId(chunk, slot));
+    seeded.neededAt[chunk] = 0;
+}
+
+void plantAllFood(SeededFood& seeded, FoodStore& food) {
+    for (uint32_t chunk = 0; chunk < seeded.chunks.size(); chunk++) {
+        if (!seeded.neededAt[chunk]) plantChunk(seeded, chunk, food);
+    }
+}
+
+// Dropped food is not seeded; it is filed under the chunk of its grid
+// position, which holds at most MAX_DROPPED_PER_CHUNK dots
+void addDroppedFood(SeededFood& seeded, FoodStore& food, const FoodDot& newFood) {
+    int32_t x = quantizePosition(newFood.x);
+    int32_t y = quantizePosition(newFood.y);
+    FoodChunk& chunk = seeded.chunks[FOOD_LAYOUT.chunkAtGrid(x, y)];
+    if (chunk.dropped.size() >= MAX_DROPPED_PER_CHUNK) return;
+    food.add(newFood);
+    uint32_t color = ((uint32_t)newFood.r << 16) | ((uint32_t)newFood.g << 8) | newFood.b;
+    chunk.dropped.push_back({ (uint32_t)newFood.id, x, y, color });  // Ids only grow, so this stays sorted
+    chunk.version++;
+}
+
+// Removes an eaten dot, noting it in its chunk
+void removeEatenFood(SeededFood& seeded, FoodStore& food, int id) {
+    int slot = food.find(id);
+    if (slot < 0) return;
+    if (id < DROPPED_FOOD_ID_BASE) {
+        uint32_t chunkIndex = (uint32_t)id >> FOOD_SLOT_BITS;
+        FoodChunk& chunk = seeded.chunks[chunkIndex];
+        if (chunk.eatOrder.empty()) seeded.eaten.push_back(chunkIndex);
+        chunk.eatOrder.push_back((uint16_t)(id & MAX_FOOD_PER_CHUNK));
+        chunk.version++;
+    }
+    else {
+        FoodChunk& chunk = seeded.chunks[FOOD_LAYOUT.chunkAtGrid(quantizePosition(food.x(slot)),
+            quantizePosition(food.y(slot)))];
+        auto it = std::lower_bound(chunk.dropped.begin(), chunk.dropped.end(), (uint32_t)id,
+            [](const SnapshotFood& dot, uint32_t value) { return dot.id < value; });
+        if (it != chunk.dropped.end() && it->id == (uint32_t)id) {
+            chunk.dropped.erase(it);
+            chunk.version++;
+        }
+    }
+    food.remove(id);
+}
+
+// Plants every chunk a cell can reach this tick and marks it needed; runs
+// after movement, right before the cells eat
+void plantNearCells(const SlotMap<PlayerData>& players, SeededFood& seeded, FoodStore& food) {
+    seeded.tick++;
+    for (size_t p = 0; p < players.size(); p++) {
+        for (const Cell& cell : players.values[p].cells) {
+            float reach = cell.size + FOOD_SIZE;
+            uint32_t lastColumn = FOOD_LAYOUT.columnFor(cell.x + reach);
+            uint32_t lastRow = FOOD_LAYOUT.rowFor(cell.y + reach);
+            for (uint32_t row = FOOD_LAYOUT.rowFor(cell.y - reach); row <= lastRow; row++) {
+                for (uint32_t column = FOOD_LAYOUT.columnFor(cell.x - reach); column <= lastColumn; column++) {
+                    uint32_t chunk = row * FOOD_LAYOUT.columns + column;
+                    if (!seeded.neededAt[chunk]) plantChunk(seeded, chunk, food);
+                    seeded.neededAt[chunk] = seeded.tick;
+                }
+            }
+        }
+    }
+}
+
+// Unplants the chunks no cell has come near for FOOD_UNPLANT_TICKS
+void unplantIdleChunks(SeededFood& seeded, FoodStore& food) {
+    for (size_t i = 0; i < seeded.planted.size();) {
+        uint32_t chunk = seeded.planted[i];
+        if (seeded.tick - seeded.neededAt[chunk] < FOOD_UNPLANT_TICKS) {
+            i++;
+            continue;
+        }
+        unplantChunk(seeded, chunk, food);
+        seeded.planted[i] = seeded.planted.back();
+        seeded.planted.pop_back();
+    }
+}
+
+// Adds FOOD_SPAWN_PER_TICK to the regrowth budget. Once it covers what the
+// most eaten chunk has lost, and that is at least 1/FOOD_REGROW_FRACTION of
+// the chunk, the chunk regrows as its next generation, in full.
+void regrowFood(SeededFood& seeded, FoodStore& food) {
+    seeded.regrowBudget = std::min(seeded.regrowBudget + FOOD_SPAWN_PER_TICK, (int)FOOD_LAYOUT.perChunk);
+    size_t mostEaten = 0;
+    size_t eaten = 0;
+    for (size_t i = 0; i < seeded.eaten.size(); i++) {
+        size_t count = seeded.chunks[seeded.eaten[i]].eatOrder.size();
+        if (count > eaten || (count == eaten && seeded.eaten[i] < seeded.eaten[mostEaten])) {
+            eaten = count;
+            mostEaten = i;
+        }
+    }
+    if (eaten == 0) return;
+    uint32_t index = seeded.eaten[mostEaten];
+    size_t threshold = std::max<size_t>(1, FOOD_LAYOUT.slotsIn(index) / FOOD_REGROW_FRACTION);
+    if (eaten < threshold || (size_t)seeded.regrowBudget < eaten) return;
+
+    seeded.regrowBudget -= (int)eaten;
+    seeded.eaten[mostEaten] = seeded.eaten.back();
+    seeded.eaten.pop_back();
+    FoodChunk& chunk = seeded.chunks[index];
+    uint32_t neededAt = seeded.neededAt[index];
+    if (neededAt) unplantChunk(seeded, index, food);
+    chunk.generation++;
+    chunk.eatOrder.clear();
+    chunk.version++;
+    if (neededAt) {
+        plantChunk(seeded, index, food);
+        seeded.planted.pop_back();  // Still listed from before
+        seeded.neededAt[index] = neededAt;
+    }
+}
+
+void convertPlayerToFood(const PlayerData& player, FoodStore& food, SeededFood& seeded,
+    int& nextFoodId) {
+    for (const auto& cell : player.cells) {
+        float cellArea = 3.14159f * cell.size * cell.size;
+        float foodArea = 3.14159f * FOOD_SIZE * FOOD_SIZE;
+        int foodCount = (int)(cellArea / foodArea);
+
+        for (int i = 0; i < foodCount; i++) {
+            FoodDot newFood;
+            newFood.id = nextFoodId++;
+            float angle = randomFloat(0, 6.28318f);
+            float distance = randomFloat(0, cell.size);
+            newFood.x = cell.x + cos(angle) * distance;
+            newFood.y = cell.y + sin(angle) * distance;
+            if (newFood.x < 5) newFood.x = 5;
+            if (newFood.x > MAP_WIDTH - 5) newFood.x = MAP_WIDTH - 5;
+            if (newFood.y < 5) newFood.y = 5;
+            if (newFood.y > MAP_HEIGHT - 5) newFood.y = MAP_HEIGHT - 5;
+            newFood.r = player.colorR;
+            newFood.g = player.colorG;
+            newFood.b = player.colorB;
+            addDroppedFood(seeded, food, newFood);
+        }
+    }
+}
+
+// Gathers the cells one viewer can see into state: its own cells plus whatever
+// the broadphase finds in its view rectangle, grouped by player and sorted by
+// the viewer's entity ids. state.header must already hold the view origin.
+void collectVisiblePlayers(SnapshotState& state, const SlotMap<PlayerData>& players, int viewer,
+    EntityTable& entities, float viewX, float viewY, const LooseQuadtree& broadphase,
+    std::vector<VisibleCell>& visible) {
+    visible.clear();
+    const PlayerData& self = players.values[viewer];
+    for (size_t i = 0; i < self.cells.size(); i++) {
+        visible.push_back({ viewer, (int)i });
+    }
+
+    float halfWidth = self.viewHalfWidth + VIEW_MARGIN;
+    float halfHeight = self.viewHalfHeight + VIEW_MARGIN;
+    broadphase.queryRect(viewX - halfWidth, viewY - halfHeight, viewX + halfWidth, viewY + halfHeight,
+        [&](const LooseQuadtree::Entry& entry) {
+            if (entry.owner != viewer) visible.push_back({ entry.owner, entry.index });
+            return true;
+        });
+
+    std::sort(visible.begin(), visible.end(), [](const VisibleCell& a, const VisibleCell& b) {
+        return (a.owner != b.owner) ? a.owner < b.owner : a.index < b.index;
+    });
+
+    SnapshotCell cells[255];
+    int32_t originX = state.originX();
+    int32_t originY = state.originY();
+    for (size_t start = 0; start < visible.size();) {
+        size_t end = start;
+        while (end < visible.size() && visible[end].owner == visible[start].owner) end++;
+
+        int owner = visible[start].owner;
+        const PlayerData& player = players.values[owner];
+        size_t cellCount = (end - start < 255) ? end - start : 255;
+        for (size_t k = 0; k < cellCount; k++) {
+            const Cell& cell = player.cells[visible[start + k].index];
+            cells[k] = { quantizePositionNear(cell.x, originX), quantizePositionNear(cell.y, originY),
+                quantizeSize(cell.size) };
+        }
+
+        SnapshotPlayer entry = { entities.idFor(players.handleAt(owner)), 0, (uint8_t)cellCount };
+        state.addPlayer(entry, cells);
+        start = end;
+    }
+
+    std::sort(state.players.begin(), state.players.end(), [](const SnapshotPlayer& a, const SnapshotPlayer& b) {
+        return a.id < b.id;
+    });
+}
+
+// The biggest players by total cell size, as (size, handle); identical for
+// every client, so built once per tick
+void buildLeaderboard(const SlotMap<PlayerData>& players, std::vector<std::pair<float, int>>& ranking,
+    std::vector<std::pair<float, PlayerHandle>>& leaderboard) {
+    ranking.clear();
+    for (size_t i = 0; i < players.size(); i++) {
+        float totalSize = 0.0f;
+        for (const auto& cell : players.values[i].cells) totalSize += cell.size;
+        ranking.push_back({ totalSize, (int)i });
+    }
+
+    size_t shown = (ranking.size() < (size_t)LEADERBOARD_SIZE) ? ranking.size() : LEADERBOARD_SIZE;
+    std::partial_sort(ranking.begin(), ranking.begin() + shown, ranking.end(),
+        [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; });
+
+    leaderboard.clear();
+    for (size_t i = 0; i < shown; i++) {
+        leaderboard.push_back({ ranking[i].first, players.handleAt(ranking[i].second) });
+    }
+}
+
+// Gathers the food chunks the viewer's view rectangle around (viewX, viewY)
+// touches, in order
+void collectChunksInView(std::vector<uint32_t>& chunks, const PlayerData& viewer, float viewX, float viewY) {
+    chunks.clear();
+    uint32_t lastColumn = FOOD_LAYOUT.columnFor(viewX + viewer.viewHalfWidth + FOOD_SIZE);
+    uint32_t lastRow = FOOD_LAYOUT.rowFor(viewY + viewer.viewHalfHeight + FOOD_SIZE);
+    for (uint32_t row = FOOD_LAYOUT.rowFor(viewY - viewer.viewHalfHeight - FOOD_SIZE); row <= lastRow; row++) {
+        for (uint32_t column = FOOD_LAYOUT.columnFor(viewX - viewer.viewHalfWidth - FOOD_SIZE); column <= lastColumn; column++) {
+            chunks.push_back(row * FOOD_LAYOUT.columns + column);
+        }
+    }
+}
+
+// The newest acknowledged snapshot still in the ring, or nullptr to send a full one
+const SnapshotState* findBaseline(const SnapshotHistory& history) {
+    uint32_t acked = history.ackedSequence;
+    if (acked == 0 || history.nextSequence - acked >= SNAPSHOT_HISTORY) return nullptr;
+    const SnapshotState& baseline = history.sent[acked % SNAPSHOT_HISTORY];
+    return (baseline.header.sequence == acked) ? &baseline : nullptr;
+}
+
+void acknowledgeSnapshot(SnapshotHistory& history, uint32_t sequence) {
+    if (sequence > history.ackedSequence && sequence < history.nextSequence) {
+        history.ackedSequence = sequence;
+    }
+}
+
+bool checkCollision(float x1, float y1, float r1, float x2, float y2, float r2) {
+    float dx = x1 - x2;
+    float dy = y1 - y2;
+    float distance = sqrt(dx * dx + dy * dy);
+    return distance < (r1 + r2);
+}
+
+bool isCompleteOverlap(float x1, float y1, float r1, float x2, float y2, float r2) {
+    float dx = x1 - x2;
+    float dy = y1 - y2;
+    float distance = sqrt(dx * dx + dy * dy);
+    return (distance + r2) <= r1;
+}
+
+PlayerHandle addPlayer(PlayerRegistry& registry, const PlayerData& player) {
+    PlayerHandle handle = registry.players.insert(player);
+    if (handle != INVALID_SLOT_HANDLE) {
+        registry.bySession[player.session] = handle;
+        registry.byAddress[makeAddressKey(player.lastSeenAddr)] = handle;
+    }
+    return handle;
+}
+
+void removePlayer(PlayerRegistry& registry, PlayerHandle handle) {
+    const PlayerData* player = registry.players.get(handle);
+    if (!player) return;
+    registry.bySession.erase(player->session);
+    auto addressIt = registry.byAddress.find(makeAddressKey(player->lastSeenAddr));
+    if (addressIt != registry.byAddress.end() && addressIt->second == handle) {
+        registry.byAddress.erase(addressIt);
+    }
+    registry.players.remove(handle);
+}
+
+PlayerHandle findPlayerByAddress(const PlayerRegistry& registry, const sockaddr_in6& addr) {
+    auto it = registry.byAddress.find(makeAddressKey(addr));
+    if (it == registry.byAddress.end()) return INVALID_SLOT_HANDLE;
+    return it->second;
+}
+
+// Records where a player's packets now come from, keeping the address index in step
+void updatePlayerAddress(PlayerRegistry& registry, PlayerHandle handle, PlayerData& player,
+    const sockaddr_in6& addr) {
+    AddressKey oldKey = makeAddressKey(player.lastSeenAddr);
+    AddressKey newKey = makeAddressKey(addr);
+    if (oldKey == newKey) return;
+
+    auto oldIt = registry.byAddress.find(oldKey);
+    if (oldIt != registry.byAddress.end() && oldIt->second == handle) {
+        registry.byAddress.erase(oldIt);
+    }
+    registry.byAddress[newKey] = handle;
+    player.lastSeenAddr = addr;
+}
+
+PlayerHandle findPlayerBySession(const PlayerRegistry& registry, uint64_t session) {
+    auto it = registry.bySession.find(session);
+    if (it == registry.bySession.end()) return INVALID_SLOT_HANDLE;
+    return it->second;
+}
+
+uint64_t playerTimerTick(std::chrono::steady_clock::time_point time) {
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()) / PLAYER_TIMER_TICK);
+}
+
+// The player is dropped after this unless it answers a ping or moves first
+std::chrono::steady_clock::time_point playerExpiry(const PlayerData& player) {
+    return std::min(player.lastPingResponse + std::chrono::seconds(PING_TIMEOUT_SECONDS),
+        player.lastMovement + std::chrono::seconds(INACTIVITY_TIMEOUT_SECONDS));
+}
+
+void schedulePlayerTimers(PlayerRegistry& registry, PlayerHandle handle, std::chrono::steady_clock::time_point now) {
+    const PlayerData& player = *registry.players.get(handle);
+    registry.timers.schedule(handle, TIMER_PING, playerTimerTick(now + std::chrono::seconds(PING_INTERVAL_SECONDS)));
+    registry.timers.schedule(handle, TIMER_EXPIRY, playerTimerTick(playerExpiry(player)) + 1);
+}
+
+// Sends the pings and drops the players whose timers came due, touching no
+// one else. Activity only moves lastPingResponse and lastMovement forward; an
+// expiry timer that finds its player active again re-arms for the new deadline.
+void runPlayerTimers(PlayerRegistry& registry, FoodStore& food, SeededFood& seeded,
+    int& nextFoodId, SOCKET serverSocket, std::chrono::steady_clock::time_point now) {
+    static std::vector<PlayerHandle> playersToRemove;
+    playersToRemove.clear();
+
+    registry.timers.advance(playerTimerTick(now), [&](uint32_t handle, uint8_t kind) {
+        PlayerData* player = registry.players.get(handle);
+        if (!player) return;  // Gone already, the timer just lapses
+
+        if (kind == TIMER_PING) {
+            uint8_t packet[MESSAGE_HEADER_SIZE];
+            ByteWriter writer(packet, sizeof(packet));
+            sendMessage(serverSocket, packet, encodeEmpty(writer, MSG_PING), player->lastSeenAddr);
+            registry.timers.schedule(handle, TIMER_PING, playerTimerTick(now + std::chrono::seconds(PING_INTERVAL_SECONDS)));
+            return;
+        }
+
+        auto expiry = playerExpiry(*player);
+        if (now <= expiry) {
+            registry.timers.schedule(handle, TIMER_EXPIRY, playerTimerTick(expiry) + 1);
+            return;
+        }
+        if (now > player->lastPingResponse + std::chrono::seconds(PING_TIMEOUT_SECONDS)) {
+            std::cout << "[TIMEOUT] " << player->name << " disconnected - converting to food" << std::endl;
+        }
+        else {
+            std::cout << "[INACTIVE] " << player->name << " disconnected - converting to food" << std::endl;
+        }
+        playersToRemove.push_back(handle);
+    });
+
+    for (PlayerHandle handle : playersToRemove) {
+        convertPlayerToFood(*registry.players.get(handle), food, seeded, nextFoodId);
+        removePlayer(registry, handle);
+    }
+}
+
+void splitPlayer(PlayerData& player) {
+    auto now = std::chrono::steady_clock::now();
+    auto timeSinceLastSplit = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - player.lastSplit).count();
+    if (timeSinceLastSplit < 100) return;
+
+    // Check if ANY cell can split (must be at least 2x MIN_PLAYER_SIZE)
+    bool canSplit = false;
+    for (const auto& cell : player.cells) {
+        if (cell.size >= MIN_PLAYER_SIZE * 2) {
+            canSplit = true;
+            break;
+        }
+    }
+
+    // If no cells can split, don't allow the split at all
+    if (!canSplit) return;
+
+    std::vector<Cell> newCells;
+    for (const auto& cell : player.cells) {
+        // Only split cells that are large enough
+        if (cell.size >= MIN_PLAYER_SIZE * 2) {
+            Cell cell1, cell2;
+            cell1.size = cell.size / 1.414f;
+            cell2.size = cell1.size;
+            float offset = cell.size * 0.6f;
+            cell1.x = cell.x - offset;
+            cell1.y = cell.y;
+            cell2.x = cell.x + offset;
+            cell2.y = cell.y;
+            newCells.push_back(cell1);
+            newCells.push_back(cell2);
+        }
+        else {
+            // Keep cells that are too small as-is
+            newCells.push_back(cell);
+        }
+    }
+    player.cells = newCells;
+    player.lastSplit = now;
+}
+
+void mergePlayer(PlayerData& player) {
+    auto now = std::chrono::steady_clock::now();
+    auto timeSinceLastMerge = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - player.lastMerge).count();
+    if (timeSinceLastMerge < 100) return;
+    if (player.cells.size() <= 1) return;
+
+    if (player.cells.size() >= 2) {
+        float minDist = 999999.0f;
+        size_t idx1 = 0, idx2 = 1;
+        for (size_t i = 0; i < player.cells.size(); i++) {
+            for (size_t j = i + 1; j < player.cells.size(); j++) {
+                float dx = player.cells[i].x - player.cells[j].x;
+                float dy = player.cells[i].y - player.cells[j].y;
+                float dist = sqrt(dx * dx + dy * dy);
+                if (dist < minDist) {
+                    minDist = dist;
+                    idx1 = i;
+                    idx2 = j;
+                }
+            }
+        }
+
+        Cell merged;
+        merged.size = sqrt(player.cells[idx1].size * player.cells[idx1].size +
+            player.cells[idx2].size * player.cells[idx2].size);
+        merged.x = (player.cells[idx1].x + player.cells[idx2].x) / 2;
+        merged.y = (player.cells[idx1].y + player.cells[idx2].y) / 2;
+
+        std::vector<Cell> newCells;
+        for (size_t i = 0; i < player.cells.size(); i++) {
+            if (i != idx1 && i != idx2) {
+                newCells.push_back(player.cells[i]);
+            }
+        }
+        newCells.push_back(merged);
+        player.cells = newCells;
+    }
+    player.lastMerge = now;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// SIM_THREADS, or one thread per hardware thread when it is 0
+int simulationThreads() {
+    if (SIM_THREADS > 0) return SIM_THREADS;
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return (hardware > 0) ? (int)hardware : 1;
+}
+
+// Whole milliseconds from now until deadline, rounded up so a wait never ends
+// before it; 0 once the deadline has passed
+int millisecondsUntil(std::chrono::steady_clock::time_point deadline) {
+    auto remaining = deadline - std::chrono::steady_clock::now();
+    if (remaining <= std::chrono::steady_clock::duration::zero()) return 0;
+    return (int)std::chrono::duration_cast<std::chrono::milliseconds>(remaining + std::chrono::milliseconds(1) -
+        std::chrono::steady_clock::duration(1)).count();
+}
+
+// Converts a reported window and zoom into the world area the player's
+// snapshots cover, within sane bounds
+void setPlayerViewport(PlayerData& player, const Viewport& viewport) {
+    float zoom = viewport.zoom;
+    if (!(zoom >= 0.1f)) zoom = 0.1f;  // Also catches NaN
+    player.viewHalfWidth = std::min(std::max(viewport.width / (2.0f * zoom), MIN_VIEW_HALF_EXTENT), MAX_VIEW_HALF_WIDTH);
+    player.viewHalfHeight = std::min(std::max(viewport.height / (2.0f * zoom), MIN_VIEW_HALF_EXTENT), MAX_VIEW_HALF_HEIGHT);
+}
+
+void bufferPlayerInput(PlayerData& player, const InputCommands& commands) {
+    if (!inputSequenceNewer(commands.sequence, player.lastInputSequence)) return;  // Duplicate or reordered
+
+    // Split and merge from every command not seen yet, in case the packets
+    // that first carried them were lost
+    for (int i = INPUT_REDUNDANCY - 1; i >= 0; i--) {
+        if (!inputSequenceNewer((uint16_t)(commands.sequence - i), player.lastInputSequence)) continue;
+        if (commands.flags[i] & INPUT_SPLIT) player.pendingSplit = true;
+        if (commands.flags[i] & INPUT_MERGE) player.pendingMerge = true;
+    }
+    player.lastInputSequence = commands.sequence;
+
+    uint8_t flags = commands.flags[0];
+    if (!(flags & INPUT_DIRECTIONS)) return;
+
+    float moveX = 0.0f, moveY = 0.0f;
+    if (flags & INPUT_UP) moveY += 1.0f;
+    if (flags & INPUT_DOWN) moveY -= 1.0f;
+    if (flags & INPUT_LEFT) moveX -= 1.0f;
+    if (flags & INPUT_RIGHT) moveX += 1.0f;
+
+    if (moveX != 0.0f && moveY != 0.0f) {
+        float length = sqrt(moveX * moveX + moveY * moveY);
+        moveX /= length;
+        moveY /= length;
+    }
+
+    // Only the latest input counts, so sending faster does not move faster
+    player.inputX = moveX;
+    player.inputY = moveY;
+    player.lastInput = std::chrono::steady_clock::now();
+}
+
+void applyPlayerInput(PlayerData& player, std::chrono::steady_clock::time_point now) {
+    if (player.pendingSplit) {
+        splitPlayer(player);
+        player.pendingSplit = false;
+    }
+
+    if (player.pendingMerge) {
+        mergePlayer(player);
+        player.pendingMerge = false;
+    }
+
+    auto timeSinceInput = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - player.lastInput).count();
+    if (timeSinceInput > INPUT_HOLD_MS) {
+        player.inputX = 0.0f;
+        player.inputY = 0.0f;
+    }
+}
+
+void movePlayer(PlayerData& player, std::chrono::steady_clock::time_point now) {
+    if (player.inputX == 0.0f && player.inputY == 0.0f) return;
+
+    player.lastMovement = now;
+    float tickScale = MOVE_SPEED_REFERENCE_RATE / TICK_RATE;
+
+    for (auto& cell : player.cells) {
+        float speed = MOVE_SPEED_BASE * (PLAYER_START_SIZE / cell.size) * tickScale;
+        float newX = cell.x + player.inputX * speed;
+        float newY = cell.y + player.inputY * speed;
+
+        if (newX < cell.size) newX = cell.size;
+        if (newX >= MAP_WIDTH - cell.size) newX = MAP_WIDTH - cell.size;
+        if (newY < cell.size) newY = cell.size;
+        if (newY >= MAP_HEIGHT - cell.size) newY = MAP_HEIGHT - cell.size;
+
+        cell.x = newX;
+        cell.y = newY;
+    }
+}
+
+struct CellRef {
+    int player;  // Dense index
+    int index;
+};
+
+// A cell's bid for a food dot it reached, kept until the claims are settled
+struct FoodReach {
+    CellRef eater;
+    uint64_t bid;
+    int slot;  // In the food store, which does not change until the claims are settled
+    int id;
+};
+
+// A cell's bid for a cell it could eat or merge with
+struct CellReach {
+    CellRef eater;
+    uint64_t bid;
+    CellRef prey;
+};
+
+// One strip's share of a tick
+struct RegionWork {
+    std::vector<int> players;    // Dense indices of players whose first cell is in the strip
+    std::vector<CellRef> cells;  // Cells whose center is in the strip
+    std::vector<FoodReach> foodReached;
+    std::vector<CellReach> cellsReached;
+    std::vector<int> eatenFood;
+    std::vector<std::pair<int, int>> kills;  // (eater, victim) dense player indices
+};
+
+// The map cut into WORLD_REGIONS vertical strips of equal width, one pool job
+// per strip. Cells of different strips can reach the same food or each other;
+// those conflicts are settled through the claim tables, never by job order, so
+// the world comes out the same for any thread or strip count.
+struct WorldPartition {
+    std::vector<RegionWork> regions;
+    std::vector<int> firstCell;  // Per player, the cellClaims slot of its first cell
+    size_t cellCount = 0;
+    float stripWidth = 1.0f;
+    ClaimTable foodClaims;       // By food store slot
+    ClaimTable cellClaims;       // By firstCell[player] + cell index
+    std::vector<int> eatenFood;
+};
+
+void initPartition(WorldPartition& partition, int regionCount) {
+    partition.regions.resize(regionCount);
+    partition.stripWidth = (float)MAP_WIDTH / regionCount;
+}
+
+int regionOf(const WorldPartition& partition, float x) {
+    int region = (int)(x / partition.stripWidth);
+    if (region < 0) return 0;
+    if (region >= (int)partition.regions.size()) return (int)partition.regions.size() - 1;
+    return region;
+}
+
+// Groups players by the strip their first cell is in, for input and movement
+void assignPlayers(WorldPartition& partition, const SlotMap<PlayerData>& players) {
+    for (RegionWork& region : partition.regions) region.players.clear();
+    for (size_t p = 0; p < players.size(); p++) {
+        const PlayerData& player = players.values[p];
+        float x = player.cells.empty() ? 0.0f : player.cells[0].x;
+        partition.regions[regionOf(partition, x)].players.push_back((int)p);
+    }
+}
+
+// Gives every cell to the strip its center is in and numbers the cells for cellClaims
+void assignCells(WorldPartition& partition, const SlotMap<PlayerData>& players) {
+    for (RegionWork& region : partition.regions) region.cells.clear();
+    partition.firstCell.resize(players.size());
+    size_t next = 0;
+    for (size_t p = 0; p < players.size(); p++) {
+        const std::vector<Cell>& cells = players.values[p].cells;
+        partition.firstCell[p] = (int)next;
+        for (size_t i = 0; i < cells.size(); i++) {
+            partition.regions[regionOf(partition, cells[i].x)].cells.push_back({ (int)p, (int)i });
+        }
+        next += cells.size();
+    }
+    partition.cellCount = next;
+}
+
+Cell& cellAt(SlotMap<PlayerData>& players, CellRef ref) {
+    return players.values[ref.player].cells[ref.index];
+}
+
+// Claim priority of a cell: the bigger cell wins, then the lower (player, cell)
+// index. Positive floats order the same as their bit patterns.
+uint64_t claimBid(const Cell& cell, CellRef ref) {
+    uint32_t sizeBits;
+    memcpy(&sizeBits, &cell.size, sizeof(sizeBits));
+    uint32_t id = ((uint32_t)ref.player << 16) | (uint32_t)ref.index;
+    return ((uint64_t)sizeBits << 32) | (0xFFFFFFFFu - id);
+}
+
+void growFromFood(Cell& cell) {
+    cell.size += FOOD_SIZE * GROWTH_RATE_FOOD;
+    if (cell.size > MAX_PLAYER_SIZE) cell.size = MAX_PLAYER_SIZE;
+}
+
+// Every cell bids for each dot it reaches, then each winner eats its dots.
+// Eaten dots leave the store in id order, so its layout does not depend on how
+// the work was split either.
+void eatFood(SlotMap<PlayerData>& players, FoodStore& food, SeededFood& seeded,
+    WorldPartition& partition, WorkStealingPool& pool) {
+    int regionCount = (int)partition.regions.size();
+    assignCells(partition, players);
+    partition.foodClaims.reserve(food.size());
+
+    pool.run(regionCount, [&](int r, int) {
+        RegionWork& region = partition.regions[r];
+        region.foodReached.clear();
+        for (const CellRef& ref : region.cells) {
+            const Cell& cell = cellAt(players, ref);
+            uint64_t bid = claimBid(cell, ref);
+            // The grid's distance kernel is the collision test: center distance < cell + food radius
+            food.grid.queryCircle(cell.x, cell.y, cell.size + FOOD_SIZE, [&](const SpatialGrid::Entry& entry) {
+                partition.foodClaims.claim(entry.slot, bid);
+                region.foodReached.push_back({ ref, bid, entry.slot, food.ids[entry.slot] });
+                return true;
+            });
+        }
+    });
+
+    pool.run(regionCount, [&](int r, int) {
+        RegionWork& region = partition.regions[r];
+        region.eatenFood.clear();
+        for (const FoodReach& reach : region.foodReached) {
+            if (partition.foodClaims.winner(reach.slot) != reach.bid) continue;
+            growFromFood(cellAt(players, reach.eater));
+            region.eatenFood.push_back(reach.id);
+        }
+    });
+
+    // Release while the slots still mean what they meant during the claims
+    partition.eatenFood.clear();
+    for (const RegionWork& region : partition.regions) {
+        for (const FoodReach& reach : region.foodReached) partition.foodClaims.release(reach.slot);
+        partition.eatenFood.insert(partition.eatenFood.end(), region.eatenFood.begin(), region.eatenFood.end());
+    }
+    std::sort(partition.eatenFood.begin(), partition.eatenFood.end());
+    for (int id : partition.eatenFood) removeEatenFood(seeded, food, id);
+}
+
+// Inserts every cell, tagged with its player's dense index and its own index
+void buildBroadphase(const SlotMap<PlayerData>& players, LooseQuadtree& broadphase) {
+    broadphase.clear((float)MAP_WIDTH, (float)MAP_HEIGHT);
+    for (size_t p = 0; p < players.size(); p++) {
+        const PlayerData& player = players.values[p];
+        for (size_t i = 0; i < player.cells.size(); i++) {
+            const Cell& cell = player.cells[i];
+            broadphase.insert(cell.x, cell.y, cell.size, (int)p, (int)i);
+        }
+    }
+}
+
+// Resolves self-merges and cell-vs-cell eating for every player. Only pairs whose
+// bounding circles overlap in the broadphase are tested, on the sizes at the
+// start of the pass. Every cell bids for each cell it could eat or absorb and
+// each prey goes to its highest bidder. A cell that is itself claimed eats
+// nothing this tick, and its own prey survive until the next one. Eaten cells
+// are flagged and removed once all claims are settled.
+void eatCells(SlotMap<PlayerData>& players, LooseQuadtree& broadphase, WorldPartition& partition,
+    WorkStealingPool& pool) {
+    static std::vector<int> eatenBy;
+    int regionCount = (int)partition.regions.size();
+    buildBroadphase(players, broadphase);
+    assignCells(partition, players);
+    partition.cellClaims.reserve(partition.cellCount);
+    auto claimSlot = [&](CellRef ref) { return (size_t)(partition.firstCell[ref.player] + ref.index); };
+
+    pool.run(regionCount, [&](int r, int) {
+        RegionWork& region = partition.regions[r];
+        region.cellsReached.clear();
+        for (const CellRef& ref : region.cells) {
+            const Cell& cell = cellAt(players, ref);
+            uint64_t bid = claimBid(cell, ref);
+            broadphase.queryCircle(cell.x, cell.y, cell.size, [&](const LooseQuadtree::Entry& entry) {
+                CellRef prey = { entry.owner, entry.index };
+                const Cell& other = cellAt(players, prey);
+                if (prey.player == ref.player) {
+                    // A player's cells merge into the lower-indexed one
+                    if (prey.index <= ref.index) return true;
+                }
+                else if (cell.size <= other.size * 1.1f) {
+                    return true;
+                }
+                if (!isCompleteOverlap(cell.x, cell.y, cell.size, other.x, other.y, other.size)) return true;
+
+                partition.cellClaims.claim(claimSlot(prey), bid);
+                region.cellsReached.push_back({ ref, bid, prey });
+                return true;
+            });
+        }
+    });
+
+    // Only unclaimed cells change here and only claimed ones are read, so no
+    // two jobs touch the same cell
+    pool.run(regionCount, [&](int r, int) {
+        RegionWork& region = partition.regions[r];
+        region.kills.clear();
+        for (const CellReach& reach : region.cellsReached) {
+            if (partition.cellClaims.winner(claimSlot(reach.eater)) != 0) continue;
+            if (partition.cellClaims.winner(claimSlot(reach.prey)) != reach.bid) continue;
+
+            Cell& cell = cellAt(players, reach.eater);
+            Cell& other = cellAt(players, reach.prey);
+            if (reach.prey.player == reach.eater.player) {
+                cell.size = sqrt(cell.size * cell.size + other.size * other.size);
+                cell.x = (cell.x + other.x) / 2;
+                cell.y = (cell.y + other.y) / 2;
+            }
+            else {
+                cell.size += other.size * GROWTH_RATE_PLAYER;
+                if (cell.size > MAX_PLAYER_SIZE) cell.size = MAX_PLAYER_SIZE;
+                region.kills.push_back({ reach.eater.player, reach.prey.player });
+            }
+            other.alive = false;
+        }
+    });
+
+    for (size_t slot = 0; slot < partition.cellCount; slot++) partition.cellClaims.release(slot);
+
+    // Any of the eaters that finished a player will do for the log; take the last
+    eatenBy.assign(players.size(), -1);
+    for (const RegionWork& region : partition.regions) {
+        for (const auto& kill : region.kills) eatenBy[kill.second] = kill.first;
+    }
+
+    std::vector<PlayerData>& order = players.values;
+    for (size_t p = 0; p < order.size(); p++) {
+        PlayerData& player = order[p];
+        player.cells.erase(std::remove_if(player.cells.begin(), player.cells.end(),
+            [](const Cell& cell) { return !cell.alive; }), player.cells.end());
+
+        if (player.cells.empty()) {
+            if (eatenBy[p] >= 0) {
+                std::cout << "[EAT] " << order[eatenBy[p]].name << " ate " << player.name << std::endl;
+            }
+            respawnPlayer(player);
+            player.lastMovement = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+// Snapshot for the player at dense index viewer, encoded against the newest
+// snapshot it acknowledged and recorded in its history, with the food events
+// the view's changes call for, in at most budget bytes past the entity
+// announcements. visible, visibleChunks, current and announcements are
+// scratch space; broadphase must hold this tick's cells.
+size_t encodeSnapshot(ByteWriter& writer, SlotMap<PlayerData>& players, int viewer,
+    const std::vector<std::pair<float, PlayerHandle>>& leaderboard, const LooseQuadtree& broadphase,
+    const SeededFood& seeded, std::vector<VisibleCell>& visible, std::vector<uint32_t>& visibleChunks,
+    SnapshotState& current, std::vector<EntityInfo>& announcements, size_t budget) {
+    PlayerData& player = players.values[viewer];
+    float avgX = 0, avgY = 0;
+    for (const auto& cell : player.cells) {
+        avgX += cell.x;
+        avgY += cell.y;
+    }
+    avgX /= player.cells.size();
+    avgY /= player.cells.size();
+
+    SnapshotHistory& history = player.snapshots;
+    EntityTable& entities = player.entities;
+    uint32_t sequence = history.nextSequence;
+    if (sequence % SNAPSHOT_HISTORY == 0) {
+        entities.sweep(sequence, [&](uint32_t handle) { return players.get(handle) != nullptr; });
+    }
+
+    current.clear();
+    current.header = { sequence, avgX, avgY, player.cells[0].size };
+    for (const auto& leader : leaderboard) {
+        current.leaderboard.push_back({ entities.idFor(leader.second), leader.first });
+    }
+    collectVisiblePlayers(current, players, viewer, entities, avgX, avgY, broadphase, visible);
+
+    entities.collectAnnouncements(sequence, history.ackedSequence, announcements,
+        [&](uint32_t handle, EntityInfo& info) {
+            const PlayerData* other = players.get(handle);
+            if (!other) return false;
+            info.r = other->colorR;
+            info.g = other->colorG;
+            info.b = other->colorB;
+            info.name = other->name;
+            return true;
+        });
+
+    // Acknowledging a snapshot acknowledges the food events it carried
+    const SnapshotState* baseline = findBaseline(history);
+    if (baseline) player.foodSync.acknowledge(baseline->foodThrough);
+    collectChunksInView(visibleChunks, player, avgX, avgY);
+    player.foodSync.update(visibleChunks, seeded.chunks, FOOD_LAYOUT, current.originX(), current.originY());
+
+    SnapshotState& sent = history.sent[sequence % SNAPSHOT_HISTORY];
+    size_t length = encodeSnapshotDelta(writer, baseline, current, announcements, entities.priority,
+        player.foodSync, seeded.chunks, budget, sent);
+    history.nextSequence++;
+    return length;
+}
+
+// Scratch space for one worker encoding snapshots, plus what it queued
+struct SnapshotWorker {
+    std::vector<VisibleCell> visible;
+    std::vector<uint32_t> visibleChunks;
+    SnapshotState current;
+    std::vector<EntityInfo> announcements;
+    std::vector<uint8_t> packet = std::vector<uint8_t>(MAX_PACKET_SIZE);
+    SendQueue outgoing;
+    size_t snapshots = 0;
+    size_t snapshotBytes = 0;
+    size_t datagrams = 0;
+    size_t held = 0;
+};
+
+// Viewers per snapshot job; small enough for stealing to even out the load
+const int SNAPSHOT_JOB_SIZE = 16;
+
+void runTick(SlotMap<PlayerData>& players, FoodStore& food, SeededFood& seeded,
+    SOCKET serverSocket, WorkStealingPool& pool, TickStats& stats) {
+    static LooseQuadtree broadphase;
+    static WorldPartition partition;
+    static std::vector<std::pair<float, int>> ranking;
+    static std::vector<std::pair<float, PlayerHandle>> leaderboard;
+    static std::vector<SnapshotWorker> workers;
+    auto tickStart = std::chrono::steady_clock::now();
+    if ((int)partition.regions.size() != WORLD_REGIONS) initPartition(partition, WORLD_REGIONS);
+    if ((int)workers.size() < pool.workerCount()) workers.resize(pool.workerCount());
+    int regionCount = (int)partition.regions.size();
+
+    assignPlayers(partition, players);
+    pool.run(regionCount, [&](int r, int) {
+        for (int p : partition.regions[r].players) applyPlayerInput(players.values[p], tickStart);
+    });
+    auto inputDone = std::chrono::steady_clock::now();
+
+    pool.run(regionCount, [&](int r, int) {
+        for (int p : partition.regions[r].players) movePlayer(players.values[p], tickStart);
+    });
+    plantNearCells(players, seeded, food);
+    unplantIdleChunks(seeded, food);
+    auto moveDone = std::chrono::steady_clock::now();
+
+    eatFood(players, food, seeded, partition, pool);
+    auto foodDone = std::chrono::steady_clock::now();
+
+    eatCells(players, broadphase, partition, pool);
+    auto cellsDone = std::chrono::steady_clock::now();
+
+    // Eating moved and removed cells, so index them again for the view queries
+    buildBroadphase(players, broadphase);
+    buildLeaderboard(players, ranking, leaderboard);
+
+    // Every viewer's snapshot only writes its own history and entity table.
+    // Each client earns SEND_RATE worth of credit per second, banks at most
+    // one SEND_PACKET_BYTES snapshot of it, and pays for what it is sent;
+    // announcements can run it into debt, which later ticks pay off.
+    int viewers = (int)players.size();
+    float creditPerTick = (float)SEND_RATE / TICK_RATE;
+    pool.run((viewers + SNAPSHOT_JOB_SIZE - 1) / SNAPSHOT_JOB_SIZE, [&](int job, int w) {
+        SnapshotWorker& worker = workers[w];
+        int end = std::min(viewers, (job + 1) * SNAPSHOT_JOB_SIZE);
+        for (int i = job * SNAPSHOT_JOB_SIZE; i < end; i++) {
+            PlayerData& viewer = players.values[i];
+            viewer.sendCredit = std::min(viewer.sendCredit + creditPerTick, (float)SEND_PACKET_BYTES);
+            if (viewer.sendCredit < MIN_SNAPSHOT_CREDIT) {
+                worker.held++;
+                continue;
+            }
+            ByteWriter writer(worker.packet.data(), snapshotCapacity());
+            size_t length = encodeSnapshot(writer, players, i, leaderboard, broadphase,
+                seeded, worker.visible, worker.visibleChunks, worker.current,
+                worker.announcements, (size_t)viewer.sendCredit);
+            viewer.sendCredit -= (float)length;
+            worker.datagrams += sendFragmented(worker.outgoing, worker.packet.data(), length,
+                worker.current.header.sequence, players.values[i].lastSeenAddr);
+            worker.snapshots++;
+            worker.snapshotBytes += length;
+        }
+    });
+
+    // The whole tick goes out together, in one sendmmsg per worker where available
+    for (SnapshotWorker& worker : workers) {
+        stats.sendCalls += flushDatagrams(serverSocket, worker.outgoing);
+        stats.datagrams += worker.datagrams;
+        stats.snapshots += worker.snapshots;
+        stats.snapshotBytes += worker.snapshotBytes;
+        stats.heldSnapshots += worker.held;
+        worker.datagrams = worker.snapshots = worker.snapshotBytes = worker.held = 0;
+    }
+    auto tickEnd = std::chrono::steady_clock::now();
+
+    double totalMs = elapsedMs(tickStart, tickEnd);
+    stats.ticks++;
+    stats.inputMs += elapsedMs(tickStart, inputDone);
+    stats.moveMs += elapsedMs(inputDone, moveDone);
+    stats.foodMs += elapsedMs(moveDone, foodDone);
+    stats.cellsMs += elapsedMs(foodDone, cellsDone);
+    stats.snapshotMs += elapsedMs(cellsDone, tickEnd);
+    stats.totalMs += totalMs;
+    if (totalMs > stats.maxTotalMs) stats.maxTotalMs = totalMs;
+    if (totalMs > 1000.0 / TICK_RATE) stats.overruns++;
+}
+
+// Admits a new player, or welcomes an existing one again when it reconnects from the same address
+void handleConnect(PlayerRegistry& registry, SOCKET serverSocket, ByteReader& reader, const sockaddr_in6& clientAddr) {
+    uint8_t reply[64];
+    ByteWriter replyWriter(reply, sizeof(reply));
+
+    ByteString playerName = reader.readString();
+    ByteString providedCode = reader.readString();
+    if (reader.failed) return;
+    Viewport viewport;
+    readViewport(reader, viewport);
+
+    // Check for server code if required
+    if (!SERVER_CODE.empty()) {
+        if (providedCode.length == 0) {
+            sendMessage(serverSocket, reply, encodeError(replyWriter, ERROR_CODE_REQUIRED), clientAddr);
+            return;
+        }
+        if (SERVER_CODE.compare(0, std::string::npos, providedCode.data, providedCode.length) != 0) {
+            sendMessage(serverSocket, reply, encodeError(replyWriter, ERROR_WRONG_CODE), clientAddr);
+            return;
+        }
+    }
+
+    PlayerHandle playerHandle = findPlayerByAddress(registry, clientAddr);
+
+    if (!registry.players.contains(playerHandle)) {
+        if (registry.players.full()) {
+            sendMessage(serverSocket, reply, encodeError(replyWriter, ERROR_SERVER_FULL), clientAddr);
+            return;
+        }
+
+        PlayerData newPlayer;
+        newPlayer.session = generateSessionId();
+        newPlayer.name = playerName.str();
+        respawnPlayer(newPlayer);
+        newPlayer.lastSeenAddr = clientAddr;
+        newPlayer.lastPingResponse = std::chrono::steady_clock::now();
+        newPlayer.lastMovement = std::chrono::steady_clock::now();
+        newPlayer.lastSplit = std::chrono::steady_clock::now();
+        newPlayer.lastMerge = std::chrono::steady_clock::now();
+        newPlayer.lastInput = std::chrono::steady_clock::now();
+        playerHandle = addPlayer(registry, newPlayer);
+        schedulePlayerTimers(registry, playerHandle, std::chrono::steady_clock::now());
+        std::cout << "[NEW] " << newPlayer.name << " joined (" << registry.players.size() << "/" << MAX_PLAYERS << ")" << std::endl;
+
+        // Update server finder with new player count
+        registerWithServerFinder(registry.players.size());
+    }
+
+    PlayerData& player = *registry.players.get(playerHandle);
+    player.lastPingResponse = std::chrono::steady_clock::now();
+    // A reconnecting client starts from an empty snapshot ring and entity table
+    player.snapshots.ackedSequence = 0;
+    player.entities = EntityTable();
+    player.foodSync = FoodSync();
+    player.lastInputSequence = 0;
+    setPlayerViewport(player, viewport);
+
+    WelcomeMessage welcome = { player.session, playerHandle, (uint32_t)MAP_WIDTH, (uint32_t)MAP_HEIGHT,
+        player.colorR, player.colorG, player.colorB, FOOD_LAYOUT.seed, FOOD_LAYOUT.chunkSize,
+        (uint16_t)FOOD_LAYOUT.perChunk };
+    sendMessage(serverSocket, reply, encodeWelcome(replyWriter, welcome), clientAddr);
+}
+
+// Handles one datagram from a client. Apart from MSG_CONNECT, this reads
+// straight out of the receive buffer and touches only preallocated player
+// state, so the steady-state receive path never allocates.
+void handleClientMessage(PlayerRegistry& registry, SOCKET serverSocket, const uint8_t* data, int length,
+    const sockaddr_in6& clientAddr) {
+    ByteReader reader(data, length);
+    uint8_t type = readMessageHeader(reader);
+    switch (type) {
+    case MSG_CONNECT:
+        handleConnect(registry, serverSocket, reader, clientAddr);
+        return;
+    case MSG_INPUT:
+    case MSG_ACK:
+    case MSG_PONG:
+    case MSG_VIEWPORT:
+    case MSG_FOOD_RESYNC:
+        break;
+    default:
+        return;
+    }
+
+    // Everything else is from a connected player and starts with its session id
+    PlayerHandle playerHandle = findPlayerBySession(registry, reader.readU64());
+    PlayerData* found = registry.players.get(playerHandle);
+    if (reader.failed || !found) return;
+
+    PlayerData& player = *found;
+    updatePlayerAddress(registry, playerHandle, player, clientAddr);
+    player.lastPingResponse = std::chrono::steady_clock::now();
+
+    if (type == MSG_ACK) {
+        uint32_t sequence = reader.readU32();
+        if (!reader.failed) acknowledgeSnapshot(player.snapshots, sequence);
+    }
+    else if (type == MSG_INPUT) {
+        // Inputs are applied on the next simulation tick, not per packet
+        InputCommands commands;
+        if (readInputCommands(reader, commands)) bufferPlayerInput(player, commands);
+    }
+    else if (type == MSG_VIEWPORT) {
+        Viewport viewport;
+        if (readViewport(reader, viewport)) setPlayerViewport(player, viewport);
+    }
+    else if (type == MSG_FOOD_RESYNC) {
+        if (player.foodSync.requestResync()) {
+            std::cout << "[FOOD] " << player.name << " asked for a food resync" << std::endl;
+        }
+    }
+}
+
+void printTickStats(TickStats& stats, size_t playerCount, size_t foodCount) {
+    if (stats.ticks == 0) return;
+
+    double budgetMs = 1000.0 / TICK_RATE;
+    double avgMs = stats.totalMs / stats.ticks;
+    std::cout << std::fixed << std::setprecision(3)
+        << "[TICK] " << stats.ticks << " ticks @ " << TICK_RATE << " Hz, "
+        << playerCount << " players, " << foodCount << " food | avg "
+        << avgMs << " ms (" << std::setprecision(1) << (avgMs / budgetMs * 100.0) << "% of "
+        << budgetMs << " ms) max " << std::setprecision(3) << stats.maxTotalMs << " ms | input "
+        << stats.inputMs / stats.ticks << " move "
+        << stats.moveMs / stats.ticks << " food "
+        << stats.foodMs / stats.ticks << " cells "
+        << stats.cellsMs / stats.ticks << " send "
+        << stats.snapshotMs / stats.ticks << " | overruns " << stats.overruns;
+    if (stats.snapshots > 0) {
+        std::cout << " | avg snapshot " << stats.snapshotBytes / stats.snapshots << " B in "
+            << std::setprecision(2) << (double)stats.datagrams / stats.snapshots << " datagrams, "
+            << (double)stats.sendCalls / stats.ticks << " send calls per tick";
+    }
+    if (stats.heldSnapshots > 0) std::cout << " | " << stats.heldSnapshots << " held back by send budget";
+    std::cout << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout.precision(6);
+    stats = TickStats();
+}
@@ -0,0 +1,271 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <random>
+#include <chrono>
+#include "network_common.h"
+#include "protocol.h"
+#include "food_store.h"
+#include "spatial_grid.h"
+#include "loose_quadtree.h"
+#include "slot_map.h"
+#include "snapshot_delta.h"
+#include "food_sync.h"
+#include "seeded_food.h"
+#include "entity_table.h"
+#include "datagram_batch.h"
+#include "timer_wheel.h"
+#include "work_stealing_pool.h"
+#include "claim_table.h"
+
+// Declarations shared by the server (game_server.cpp, main.cpp) and its
+// benchmarks (benchmarks.cpp). Configuration variables are defined in
+// game_server.cpp and loaded from server_config.txt.
+
+// Server Finder configuration (must match server_finder)
+const std::string SERVER_FINDER_IP_ADDR = "::1";  // Change to your server finder IP
+const int SERVER_FINDER_PORT_NUM = 7777;
+
+// Configuration variables (loaded from file)
+extern int MAP_WIDTH;
+extern int MAP_HEIGHT;
+extern int MAX_PLAYERS;
+extern std::string SERVER_NAME;
+extern std::string SERVER_CODE;  // Optional join code
+extern float FOOD_PERCENTAGE;
+extern int FOOD_SPAWN_PER_TICK;
+extern int PING_TIMEOUT_SECONDS;
+extern int INACTIVITY_TIMEOUT_SECONDS;
+extern float MOVE_SPEED_BASE;
+extern float GROWTH_RATE_FOOD;
+extern float GROWTH_RATE_PLAYER;
+extern float PLAYER_START_SIZE_PERCENTAGE;
+extern float PLAYER_MAX_SIZE_PERCENTAGE;
+extern int GAME_SERVER_PORT;
+extern int TICK_RATE;
+// Largest datagram the server sends; bigger snapshots are split into MSG_FRAGMENT pieces
+extern int MTU;
+// Each client's send budget: bytes per second on average, and at most
+// SEND_PACKET_BYTES in one snapshot, however long the client waited
+extern int SEND_RATE;
+extern int SEND_PACKET_BYTES;
+// A client with less credit than this skips the tick's snapshot
+const float MIN_SNAPSHOT_CREDIT = 64.0f;
+// Simulation threads, 0 for one per hardware thread
+extern int SIM_THREADS;
+// Vertical strips the map is simulated in; results depend on this, never on SIM_THREADS
+extern int WORLD_REGIONS;
+
+// Lays out the seeded food; 0 picks a new seed at every start
+extern uint64_t WORLD_SEED;
+
+extern int MAX_FOOD;
+// Seeded food: chunks of FOOD_CHUNK_SIZE units that together hold MAX_FOOD dots
+const uint32_t FOOD_CHUNK_SIZE = 512;
+extern FoodLayout FOOD_LAYOUT;
+// Seeded food ids are chunk << FOOD_SLOT_BITS | slot; dropped food counts up from here
+const int DROPPED_FOOD_ID_BASE = 1 << 30;
+// A chunk regrows once it has lost this fraction of its dots, so each regrowth is worth sending
+const int FOOD_REGROW_FRACTION = 4;
+// Dropped food one chunk can hold; food dropped into a full chunk is lost
+const size_t MAX_DROPPED_PER_CHUNK = 512;
+// A planted chunk no cell has come near for this many ticks goes back to
+// being just its generation and eaten slots
+const uint32_t FOOD_UNPLANT_TICKS = 100;
+// Half extents of what a client sees until it reports its viewport, in world
+// units: a 1920x1080 window at the client's 2x zoom
+const float VIEW_HALF_WIDTH = 480.0f;
+const float VIEW_HALF_HEIGHT = 270.0f;
+// Reported viewports are clamped to this, so a huge window or tiny zoom
+// cannot ask for most of the map every tick
+const float MAX_VIEW_HALF_WIDTH = 1280.0f;
+const float MAX_VIEW_HALF_HEIGHT = 1280.0f;
+const float MIN_VIEW_HALF_EXTENT = 50.0f;
+// Cells this close to the edge of the view are sent too, so they do not pop in
+const float VIEW_MARGIN = 100.0f;
+// Players outside the view only reach clients through the leaderboard
+const int LEADERBOARD_SIZE = 10;
+// Food grid buckets are this many food radii wide
+const float FOOD_GRID_CELL_FACTOR = 16.0f;
+const int PING_INTERVAL_SECONDS = 10;
+const int TICK_STATS_INTERVAL_SECONDS = 10;
+
+// Main loop timers besides the tick
+const std::chrono::seconds FINDER_UPDATE_INTERVAL(30);
+const std::chrono::milliseconds FOOD_REGROW_INTERVAL(100);
+
+// Per-player pings and expiry checks run on a timer wheel with this resolution
+const std::chrono::milliseconds PLAYER_TIMER_TICK(100);
+enum PlayerTimer : uint8_t {
+    TIMER_PING = 0,
+    TIMER_EXPIRY = 1
+};
+
+// Movement speeds were tuned when every 50 ms input packet moved the player once
+const float MOVE_SPEED_REFERENCE_RATE = 20.0f;
+// A held direction stays active this long after the last input packet
+const int INPUT_HOLD_MS = 120;
+
+extern float PLAYER_START_SIZE;
+extern float MIN_PLAYER_SIZE;
+extern float MAX_PLAYER_SIZE;
+extern float FOOD_SIZE;
+
+struct Cell {
+    float x;
+    float y;
+    float size;
+    bool alive = true;  // Cleared when eaten or merged during a tick
+};
+
+struct TickStats {
+    int ticks = 0;
+    int overruns = 0;
+    double inputMs = 0.0;
+    double moveMs = 0.0;
+    double foodMs = 0.0;
+    double cellsMs = 0.0;
+    double snapshotMs = 0.0;
+    size_t snapshots = 0;
+    size_t snapshotBytes = 0;
+    size_t datagrams = 0;
+    size_t sendCalls = 0;
+    size_t heldSnapshots = 0;  // Skipped for lack of send credit
+    double totalMs = 0.0;
+    double maxTotalMs = 0.0;
+};
+
+// Snapshots recently sent to one client, at sequence % SNAPSHOT_HISTORY
+struct SnapshotHistory {
+    std::vector<SnapshotState> sent = std::vector<SnapshotState>(SNAPSHOT_HISTORY);
+    uint32_t nextSequence = 1;
+    uint32_t ackedSequence = 0;  // Newest sequence the client acknowledged, 0 for none
+};
+
+struct PlayerData {
+    uint64_t session;
+    std::string name;
+    std::vector<Cell> cells;
+    uint8_t colorR;
+    uint8_t colorG;
+    uint8_t colorB;
+    sockaddr_in6 lastSeenAddr;
+    float inputX = 0.0f;
+    float inputY = 0.0f;
+    bool pendingSplit = false;
+    bool pendingMerge = false;
+    uint16_t lastInputSequence = 0;  // Newest input command applied
+    float viewHalfWidth = VIEW_HALF_WIDTH;  // Reported viewport in world units
+    float viewHalfHeight = VIEW_HALF_HEIGHT;
+    std::chrono::steady_clock::time_point lastInput;
+    std::chrono::steady_clock::time_point lastPingResponse;
+    std::chrono::steady_clock::time_point lastMovement;
+    std::chrono::steady_clock::time_point lastSplit;
+    std::chrono::steady_clock::time_point lastMerge;
+    SnapshotHistory snapshots;
+    EntityTable entities;  // Ids this client knows other players by
+    FoodSync foodSync;     // The food this client holds, and the events on their way to it
+    float sendCredit = (float)SEND_PACKET_BYTES;  // Bytes this client may still be sent
+};
+
+typedef SlotHandle PlayerHandle;
+
+// Raw IPv6 address bytes plus port, used to find a player by where packets come from
+struct AddressKey {
+    uint8_t bytes[16];
+    uint16_t port;
+
+    bool operator==(const AddressKey& other) const {
+        return port == other.port && memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
+};
+
+struct AddressKeyHash {
+    size_t operator()(const AddressKey& key) const {
+        // FNV-1a over the address bytes and port
+        uint64_t hash = 14695981039346656037ull;
+        for (int i = 0; i < 16; i++) {
+            hash = (hash ^ key.bytes[i]) * 1099511628211ull;
+        }
+        hash = (hash ^ (key.port & 0xFF)) * 1099511628211ull;
+        hash = (hash ^ (key.port >> 8)) * 1099511628211ull;
+        return (size_t)hash;
+    }
+};
+
+// Players live densely in a slot map and are addressed by handle. The session
+// id is the secret clients put in every packet, resolved through a side hash
+// table; the address index answers "is this sender already connected" without
+// a scan. Snapshots identify players by handle, never by session.
+struct PlayerRegistry {
+    SlotMap<PlayerData> players;
+    std::unordered_map<uint64_t, PlayerHandle> bySession;
+    std::unordered_map<AddressKey, PlayerHandle, AddressKeyHash> byAddress;
+    TimerWheel timers;  // Every player's next ping and expiry check, keyed by handle
+};
+
+// The seeded food's chunks. Only chunks a cell has come near lately are
+// planted, with their uneaten dots in the food store; the rest are just a
+// generation, eaten slots and dropped food, so a bigger map costs memory per
+// chunk rather than per dot, and nothing per tick.
+struct SeededFood {
+    std::vector<FoodChunk> chunks;
+    std::vector<uint32_t> neededAt;  // Tick a cell last came near the chunk, 0 while unplanted
+    std::vector<uint32_t> planted;
+    std::vector<uint32_t> eaten;     // Chunks with eaten slots, the ones that can regrow
+    uint32_t tick = 0;
+    int regrowBudget = 0;
+};
+
+struct VisibleCell {
+    int owner;
+    int index;
+};
+
+extern std::mt19937 gen;
+
+// Configuration and the server finder
+void layoutSeededFood(uint64_t seed);
+bool loadConfig();
+void registerWithServerFinder(int currentPlayers);
+
+// Players
+uint64_t generateSessionId();
+float randomFloat(float min, float max);
+void respawnPlayer(PlayerData& player);
+PlayerHandle addPlayer(PlayerRegistry& registry, const PlayerData& player);
+bool checkCollision(float x1, float y1, float r1, float x2, float y2, float r2);
+uint64_t playerTimerTick(std::chrono::steady_clock::time_point time);
+void runPlayerTimers(PlayerRegistry& registry, FoodStore& food, SeededFood& seeded,
+    int& nextFoodId, SOCKET serverSocket, std::chrono::steady_clock::time_point now);
+
+// Food
+void initSeededFood(SeededFood& seeded);
+void plantAllFood(SeededFood& seeded, FoodStore& food);
+void addDroppedFood(SeededFood& seeded, FoodStore& food, const FoodDot& newFood);
+void removeEatenFood(SeededFood& seeded, FoodStore& food, int id);
+void regrowFood(SeededFood& seeded, FoodStore& food);
+
+// Ticks and snapshots
+void buildLeaderboard(const SlotMap<PlayerData>& players, std::vector<std::pair<float, int>>& ranking,
+    std::vector<std::pair<float, PlayerHandle>>& leaderboard);
+void buildBroadphase(const SlotMap<PlayerData>& players, LooseQuadtree& broadphase);
+void acknowledgeSnapshot(SnapshotHistory& history, uint32_t sequence);
+size_t encodeSnapshot(ByteWriter& writer, SlotMap<PlayerData>& players, int viewer,
+    const std::vector<std::pair<float, PlayerHandle>>& leaderboard, const LooseQuadtree& broadphase,
+    const SeededFood& seeded, std::vector<VisibleCell>& visible, std::vector<uint32_t>& visibleChunks,
+    SnapshotState& current, std::vector<EntityInfo>& announcements, size_t budget);
+void runTick(SlotMap<PlayerData>& players, FoodStore& food, SeededFood& seeded,
+    SOCKET serverSocket, WorkStealingPool& pool, TickStats& stats);
+void handleClientMessage(PlayerRegistry& registry, SOCKET serverSocket, const uint8_t* data, int length,
+    const sockaddr_in6& clientAddr);
+void printTickStats(TickStats& stats, size_t playerCount, size_t foodCount);
+
+// Timing
+double elapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+int simulationThreads();
+int millisecondsUntil(std::chrono::steady_clock::time_point deadline);
+
+// Runs the named benchmark, or all of them for an empty name (benchmarks.cpp)
+void runBenchmarks(const std::string& which);
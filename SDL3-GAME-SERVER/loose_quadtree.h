@@ -0,0 +1,132 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Loose quadtree over circles, rebuilt every tick. A node's loose bounds are
+// twice its tight bounds, so each circle is stored in exactly one node: the
+// deepest one whose tight bounds hold its center and whose size covers its radius.
+struct LooseQuadtree {
+    struct Entry {
+        float x;
+        float y;
+        float radius;
+        int owner;
+        int index;
+        int next;
+    };
+
+    struct Node {
+        float centerX;
+        float centerY;
+        float halfSize;
+        int children[4];
+        int firstEntry;
+    };
+
+    static const int MAX_DEPTH = 10;
+
+    std::vector<Node> nodes;
+    std::vector<Entry> entries;
+
+    static Node makeNode(float centerX, float centerY, float halfSize) {
+        Node node;
+        node.centerX = centerX;
+        node.centerY = centerY;
+        node.halfSize = halfSize;
+        node.children[0] = node.children[1] = node.children[2] = node.children[3] = -1;
+        node.firstEntry = -1;
+        return node;
+    }
+
+    // Empties the tree but keeps its storage, so rebuilding each tick does not allocate
+    void clear(float width, float height) {
+        nodes.clear();
+        entries.clear();
+        float halfSize = ((width > height) ? width : height) * 0.5f;
+        nodes.push_back(makeNode(width * 0.5f, height * 0.5f, halfSize));
+    }
+
+    std::size_t size() const {
+        return entries.size();
+    }
+
+    void insert(float x, float y, float radius, int owner, int index) {
+        int nodeIndex = 0;
+        for (int depth = 0; depth < MAX_DEPTH; depth++) {
+            float childHalf = nodes[nodeIndex].halfSize * 0.5f;
+            if (radius > childHalf) break;
+
+            int quadrant = (x >= nodes[nodeIndex].centerX ? 1 : 0) + (y >= nodes[nodeIndex].centerY ? 2 : 0);
+            if (nodes[nodeIndex].children[quadrant] < 0) {
+                float childX = nodes[nodeIndex].centerX + ((quadrant & 1) ? childHalf : -childHalf);
+                float childY = nodes[nodeIndex].centerY + ((quadrant & 2) ? childHalf : -childHalf);
+                int child = (int)nodes.size();
+                nodes.push_back(makeNode(childX, childY, childHalf));
+                nodes[nodeIndex].children[quadrant] = child;
+            }
+            nodeIndex = nodes[nodeIndex].children[quadrant];
+        }
+
+        Entry entry = { x, y, radius, owner, index, nodes[nodeIndex].firstEntry };
+        nodes[nodeIndex].firstEntry = (int)entries.size();
+        entries.push_back(entry);
+    }
+
+    // Calls fn(entry) for every circle overlapping the query circle; fn returns false to stop early
+    template<typename Fn>
+    void queryCircle(float x, float y, float radius, Fn fn) const {
+        if (nodes.empty()) return;
+
+        int stack[MAX_DEPTH * 4 + 4];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const Node& node = nodes[stack[--stackSize]];
+            float reach = node.halfSize * 2.0f + radius;
+            if (x < node.centerX - reach || x > node.centerX + reach ||
+                y < node.centerY - reach || y > node.centerY + reach) continue;
+
+            for (int i = node.firstEntry; i >= 0; i = entries[i].next) {
+                const Entry& entry = entries[i];
+                float dx = entry.x - x;
+                float dy = entry.y - y;
+                float limit = entry.radius + radius;
+                if (dx * dx + dy * dy >= limit * limit) continue;
+                if (!fn(entry)) return;
+            }
+
+            for (int child : node.children) {
+                if (child >= 0) stack[stackSize++] = child;
+            }
+        }
+    }
+
+    // Calls fn(entry) for every circle whose bounding box overlaps the rectangle; fn returns false to stop early
+    template<typename Fn>
+    void queryRect(float minX, float minY, float maxX, float maxY, Fn fn) const {
+        if (nodes.empty()) return;
+
+        int stack[MAX_DEPTH * 4 + 4];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const Node& node = nodes[stack[--stackSize]];
+            float reach = node.halfSize * 2.0f;
+            if (maxX < node.centerX - reach || minX > node.centerX + reach ||
+                maxY < node.centerY - reach || minY > node.centerY + reach) continue;
+
+            for (int i = node.firstEntry; i >= 0; i = entries[i].next) {
+                const Entry& entry = entries[i];
+                if (entry.x + entry.radius < minX || entry.x - entry.radius > maxX ||
+                    entry.y + entry.radius < minY || entry.y - entry.radius > maxY) continue;
+                if (!fn(entry)) return;
+            }
+
+            for (int child : node.children) {
+                if (child >= 0) stack[stackSize++] = child;
+            }
+        }
+    }
+};
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <chrono>
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include "game_server.h"
+
+// Receive path benchmark: the time handleClientMessage takes per input, ack
+// and pong, and the heap allocations it makes doing so
+
+// Every heap allocation in the process goes through here, so the benchmark can
+// check that handling steady-state messages allocates nothing. Replacing the
+// global allocator is why this is its own executable rather than part of the
+// server's --benchmark set.
+std::atomic<size_t> allocationCount{ 0 };
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* memory = malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+// Returns the heap allocations the timed messages made, which should be none
+size_t runReceiveBenchmark() {
+    const int PLAYERS = 200;
+    const int MESSAGES = 1000000;
+
+    PlayerRegistry registry;
+    registry.players.init(PLAYERS);
+    registry.bySession.reserve(PLAYERS);
+    registry.byAddress.reserve(PLAYERS);
+    std::vector<sockaddr_in6> addresses(PLAYERS);
+    std::vector<uint64_t> sessions(PLAYERS);
+    for (int i = 0; i < PLAYERS; i++) {
+        sockaddr_in6& addr = addresses[i];
+        memset(&addr, 0, sizeof(addr));
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_loopback;
+        addr.sin6_port = htons((uint16_t)(20000 + i));
+
+        PlayerData player;
+        player.session = generateSessionId();
+        player.lastSeenAddr = addr;
+        player.snapshots.nextSequence = 0xFFFFFFFFu;  // Any ack is for a snapshot that was sent
+        sessions[i] = player.session;
+        addPlayer(registry, player);
+    }
+
+    // Inputs, acks and pongs in turn, each player's sequences counting up like a live client's
+    uint8_t packet[64];
+    std::vector<InputCommands> inputs(PLAYERS);
+    auto receive = [&](int k) {
+        int i = k % PLAYERS;
+        int round = k / PLAYERS;
+        ByteWriter writer(packet, sizeof(packet));
+        size_t length = 0;
+        if (round % 3 == 0) {
+            InputCommands& commands = inputs[i];
+            for (int j = INPUT_REDUNDANCY - 1; j > 0; j--) commands.flags[j] = commands.flags[j - 1];
+            commands.flags[0] = (round % 2) ? INPUT_LEFT : INPUT_UP;
+            commands.sequence++;
+            length = encodeInput(writer, sessions[i], commands);
+        }
+        else if (round % 3 == 1) {
+            length = encodeAck(writer, sessions[i], (uint32_t)round);
+        }
+        else {
+            length = encodeSessionMessage(writer, MSG_PONG, sessions[i]);
+        }
+        handleClientMessage(registry, INVALID_SOCKET, packet, (int)length, addresses[i]);
+    };
+
+    for (int k = 0; k < PLAYERS * 3; k++) receive(k);  // Warm up
+
+    size_t allocationsBefore = allocationCount;
+    auto start = std::chrono::steady_clock::now();
+    for (int k = PLAYERS * 3; k < PLAYERS * 3 + MESSAGES; k++) receive(k);
+    double receiveMs = elapsedMs(start, std::chrono::steady_clock::now());
+    size_t allocations = allocationCount - allocationsBefore;
+
+    std::cout << "Receive path benchmark: " << MESSAGES << " inputs, acks and pongs from " << PLAYERS
+        << " players" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+        << receiveMs * 1000000.0 / MESSAGES << " ns per message, " << allocations << " heap allocations"
+        << ((allocations == 0) ? "" : "   ALLOCATES") << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout.precision(6);
+    return allocations;
+}
+
+// Exits nonzero when the receive path allocated, so scripted runs catch it
+int main() {
+    return (runReceiveBenchmark() == 0) ? 0 : 1;
+}
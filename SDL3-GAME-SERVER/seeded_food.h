@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// The food the map grows by itself is never sent dot by dot. The map is cut
+// into square chunks, and the dots of a chunk are a pure function of the
+// world seed, the chunk and the chunk's generation, computed with integer
+// math only so the client and server lay them out identically. All a client
+// needs to be told is each chunk's generation and which of its slots have
+// been eaten since. A chunk that has been eaten from regrows as its next
+// generation: a fresh layout with every slot full.
+//
+// The server and client each carry a copy of this file; keep them identical.
+
+const int FOOD_SLOT_BITS = 12;
+const uint32_t MAX_FOOD_PER_CHUNK = (1 << FOOD_SLOT_BITS) - 1;
+const int FOOD_CHUNK_BITS = 16;
+const uint32_t MAX_FOOD_CHUNKS = 1 << FOOD_CHUNK_BITS;
+const int32_t FOOD_EDGE_MARGIN = 5;  // World units between a dot and the map edge
+const int32_t FOOD_GRID_PER_UNIT = 8;  // Seeded positions are on the 1/8 unit position grid
+
+inline uint64_t mixFood(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// A seeded dot, with its position on the grid quantizePosition uses
+struct SeededDot {
+    int32_t x;
+    int32_t y;
+    uint32_t color;  // 0x00RRGGBB
+};
+
+struct FoodLayout {
+    uint64_t seed = 0;
+    uint32_t mapWidth = 0;
+    uint32_t mapHeight = 0;
+    uint32_t chunkSize = 0;  // World units
+    uint32_t perChunk = 0;   // Dots in a whole chunk; edge chunks get their share by area
+    uint32_t columns = 0;
+    uint32_t rows = 0;
+
+    // chunkSize doubles until the map fits in MAX_FOOD_CHUNKS chunks
+    void init(uint64_t worldSeed, uint32_t width, uint32_t height, uint32_t size, uint32_t dotsPerChunk) {
+        seed = worldSeed;
+        mapWidth = width;
+        mapHeight = height;
+        chunkSize = (size > 0) ? size : 1;
+        while (true) {
+            columns = (mapWidth + chunkSize - 1) / chunkSize;
+            rows = (mapHeight + chunkSize - 1) / chunkSize;
+            if ((uint64_t)columns * rows <= MAX_FOOD_CHUNKS) break;
+            chunkSize *= 2;
+        }
+        perChunk = (dotsPerChunk < MAX_FOOD_PER_CHUNK) ? dotsPerChunk : MAX_FOOD_PER_CHUNK;
+    }
+
+    uint32_t chunkCount() const {
+        return columns * rows;
+    }
+
+    uint32_t columnFor(float x) const {
+        int32_t column = (int32_t)(x / chunkSize);
+        if (column < 0) return 0;
+        return ((uint32_t)column >= columns) ? columns - 1 : (uint32_t)column;
+    }
+
+    uint32_t rowFor(float y) const {
+        int32_t row = (int32_t)(y / chunkSize);
+        if (row < 0) return 0;
+        return ((uint32_t)row >= rows) ? rows - 1 : (uint32_t)row;
+    }
+
+    // The chunk holding a position on the 1/8 unit grid; the server files
+    // dropped food by it and the client finds it again the same way
+    uint32_t chunkAtGrid(int32_t x, int32_t y) const {
+        int64_t span = (int64_t)chunkSize * FOOD_GRID_PER_UNIT;
+        int64_t column = (x < 0) ? 0 : x / span;
+        int64_t row = (y < 0) ? 0 : y / span;
+        if (column >= columns) column = columns - 1;
+        if (row >= rows) row = rows - 1;
+        return (uint32_t)(row * columns + column);
+    }
+
+    // Where the chunk's dots may lie, in world units
+    void bounds(uint32_t chunk, int32_t& minX, int32_t& minY, int32_t& maxX, int32_t& maxY) const {
+        int32_t column = (int32_t)(chunk % columns);
+        int32_t row = (int32_t)(chunk / columns);
+        minX = column * (int32_t)chunkSize;
+        minY = row * (int32_t)chunkSize;
+        maxX = minX + (int32_t)chunkSize;
+        maxY = minY + (int32_t)chunkSize;
+        if (minX < FOOD_EDGE_MARGIN) minX = FOOD_EDGE_MARGIN;
+        if (minY < FOOD_EDGE_MARGIN) minY = FOOD_EDGE_MARGIN;
+        if (maxX > (int32_t)mapWidth - FOOD_EDGE_MARGIN) maxX = (int32_t)mapWidth - FOOD_EDGE_MARGIN;
+        if (maxY > (int32_t)mapHeight - FOOD_EDGE_MARGIN) maxY = (int32_t)mapHeight - FOOD_EDGE_MARGIN;
+    }
+
+    uint32_t slotsIn(uint32_t chunk) const {
+        int32_t minX, minY, maxX, maxY;
+        bounds(chunk, minX, minY, maxX, maxY);
+        if (maxX <= minX || maxY <= minY) return 0;
+        uint64_t area = (uint64_t)(maxX - minX) * (uint64_t)(maxY - minY);
+        return (uint32_t)(perChunk * area / ((uint64_t)chunkSize * chunkSize));
+    }
+
+    // The dot in one slot of one generation of a chunk
+    SeededDot dot(uint32_t chunk, uint32_t generation, uint32_t slot) const {
+        int32_t minX, minY, maxX, maxY;
+        bounds(chunk, minX, minY, maxX, maxY);
+        uint64_t hash = mixFood(seed ^ mixFood(((uint64_t)chunk << 32) | generation) ^ ((uint64_t)slot << 40));
+        uint64_t spanX = (uint64_t)(maxX - minX) * FOOD_GRID_PER_UNIT;
+        uint64_t spanY = (uint64_t)(maxY - minY) * FOOD_GRID_PER_UNIT;
+
+        SeededDot result;
+        result.x = minX * FOOD_GRID_PER_UNIT + (int32_t)(hash % spanX);
+        hash = mixFood(hash);
+        result.y = minY * FOOD_GRID_PER_UNIT + (int32_t)(hash % spanY);
+        hash = mixFood(hash);
+        uint32_t r = 100 + (uint32_t)(hash % 156);
+        uint32_t g = 100 + (uint32_t)((hash >> 16) % 156);
+        uint32_t b = 100 + (uint32_t)((hash >> 32) % 156);
+        result.color = (r << 16) | (g << 8) | b;
+        return result;
+    }
+};
+
+// Checksum terms for a chunk the client holds: one for the chunk and
+// generation, plus one per eaten slot
+inline uint32_t chunkHash(uint32_t chunk, uint32_t generation) {
+    return (uint32_t)mixFood(((uint64_t)chunk << 32) | generation);
+}
+
+inline uint32_t eatenSlotHash(uint32_t chunk, uint32_t generation, uint32_t slot) {
+    return (uint32_t)mixFood((((uint64_t)chunk << 32) | generation) ^ ((uint64_t)(slot + 1) << 48));
+}
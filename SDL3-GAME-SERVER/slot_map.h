@@ -0,0 +1,127 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+// 32-bit handle: low 16 bits are the slot index, high 16 bits its generation.
+// A handle goes stale as soon as its slot is freed, so old handles never alias new entries.
+typedef uint32_t SlotHandle;
+const SlotHandle INVALID_SLOT_HANDLE = 0xFFFFFFFFu;
+
+// Fixed-capacity slot map. Values live densely packed for iteration; slots map
+// handles to dense positions so lookup, insert and remove are all O(1).
+template<typename T>
+struct SlotMap {
+    struct Slot {
+        uint16_t generation;
+        uint16_t dense;
+        uint16_t nextFree;
+    };
+
+    static const uint16_t NO_SLOT = 0xFFFF;
+
+    std::vector<T> values;
+    std::vector<uint16_t> denseToSlot;
+    std::vector<Slot> slots;
+    uint16_t firstFree = NO_SLOT;
+
+    // Preallocates every slot up front; capacity is capped at 65535
+    void init(int capacity) {
+        if (capacity < 1) capacity = 1;
+        if (capacity > NO_SLOT) capacity = NO_SLOT;
+
+        values.clear();
+        values.reserve(capacity);
+        denseToSlot.clear();
+        denseToSlot.reserve(capacity);
+        slots.assign(capacity, Slot());
+        for (int i = 0; i < capacity; i++) {
+            slots[i].generation = 1;
+            slots[i].dense = NO_SLOT;
+            slots[i].nextFree = (i + 1 < capacity) ? (uint16_t)(i + 1) : NO_SLOT;
+        }
+        firstFree = 0;
+    }
+
+    static uint16_t indexOf(SlotHandle handle) {
+        return (uint16_t)(handle & 0xFFFF);
+    }
+
+    static uint16_t generationOf(SlotHandle handle) {
+        return (uint16_t)(handle >> 16);
+    }
+
+    std::size_t size() const {
+        return values.size();
+    }
+
+    bool full() const {
+        return firstFree == NO_SLOT;
+    }
+
+    SlotHandle insert(const T& value) {
+        if (firstFree == NO_SLOT) return INVALID_SLOT_HANDLE;
+
+        uint16_t index = firstFree;
+        Slot& slot = slots[index];
+        firstFree = slot.nextFree;
+        slot.dense = (uint16_t)values.size();
+        slot.nextFree = NO_SLOT;
+        values.push_back(value);
+        denseToSlot.push_back(index);
+        return ((SlotHandle)slot.generation << 16) | index;
+    }
+
+    bool remove(SlotHandle handle) {
+        if (!contains(handle)) return false;
+
+        uint16_t index = indexOf(handle);
+        Slot& slot = slots[index];
+        uint16_t dense = slot.dense;
+        uint16_t last = (uint16_t)(values.size() - 1);
+
+        if (dense != last) {
+            values[dense] = std::move(values[last]);
+            denseToSlot[dense] = denseToSlot[last];
+            slots[denseToSlot[dense]].dense = dense;
+        }
+        values.pop_back();
+        denseToSlot.pop_back();
+
+        slot.dense = NO_SLOT;
+        slot.generation++;
+        if (slot.generation == 0) slot.generation = 1;
+        slot.nextFree = firstFree;
+        firstFree = index;
+        return true;
+    }
+
+    bool contains(SlotHandle handle) const {
+        uint16_t index = indexOf(handle);
+        if (index >= slots.size()) return false;
+        const Slot& slot = slots[index];
+        return slot.dense != NO_SLOT && slot.generation == generationOf(handle);
+    }
+
+    T* get(SlotHandle handle) {
+        if (!contains(handle)) return nullptr;
+        return &values[slots[indexOf(handle)].dense];
+    }
+
+    const T* get(SlotHandle handle) const {
+        if (!contains(handle)) return nullptr;
+        return &values[slots[indexOf(handle)].dense];
+    }
+
+    // Handle of the value at a dense position, for use while iterating
+    SlotHandle handleAt(std::size_t dense) const {
+        uint16_t index = denseToSlot[dense];
+        return ((SlotHandle)slots[index].generation << 16) | index;
+    }
+
+    typename std::vector<T>::iterator begin() { return values.begin(); }
+    typename std::vector<T>::iterator end() { return values.end(); }
+    typename std::vector<T>::const_iterator begin() const { return values.begin(); }
+    typename std::vector<T>::const_iterator end() const { return values.end(); }
+};
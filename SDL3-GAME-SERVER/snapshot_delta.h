@@ -0,0 +1,581 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+#include "protocol.h"
+#include "food_sync.h"
+
+// What one client was sent in one snapshot, and the delta coding between two
+// of them. The server keeps the last SNAPSHOT_HISTORY states it sent each
+// client and encodes every new snapshot against the newest one that client
+// acknowledged. The client keeps the same ring and rebuilds each full state
+// from the baseline the snapshot names. Baseline 0 means "against nothing",
+// which makes the delta a full snapshot.
+//
+// Positions and sizes are kept quantized (see protocol.h), so the server's
+// record of a snapshot and the client's rebuild compare exactly. Player
+// records are bit-packed, with positions as offsets from the snapshot origin:
+// the viewer's position on the grid.
+//
+// Food is not part of the ring. Snapshots carry it as events from the
+// client's food stream (see food_sync.h), and each ring entry notes how far
+// into the stream its snapshot reached, so acknowledging the snapshot
+// acknowledges those events.
+//
+// A snapshot can be held to a byte budget. Player records then compete for
+// it by send priority, which grows every snapshot a player's record waits and
+// faster for near and big players, so the far edge of the view falls behind
+// first and nothing falls behind forever.
+//
+// Players are referred to by per-connection entity ids. Their name and color
+// travel separately as EntityInfo announcements, repeated in every snapshot
+// until the client acknowledges one that carried them.
+//
+// The server and client each carry a copy of this file; keep them identical.
+
+const uint32_t SNAPSHOT_HISTORY = 32;
+
+// SECTION_PLAYERS record flags
+const uint8_t PLAYER_CELLS = 1 << 0;       // Cell count and the full cell list follow
+const uint8_t PLAYER_CELL_DELTA = 1 << 1;  // One change mask per baseline cell, then the changed fields
+
+// Per-cell change mask used by PLAYER_CELL_DELTA
+const uint8_t CELL_X = 1 << 0;
+const uint8_t CELL_Y = 1 << 1;
+const uint8_t CELL_SIZE = 1 << 2;
+
+const int ENTITY_ID_BITS = 16;
+const int PLAYER_FLAG_BITS = 2;
+const int CELL_COUNT_BITS = 8;
+const int CELL_MASK_BITS = 3;
+
+// Distance, in world units, at which a player's send priority grows half as
+// fast as it would at the snapshot origin
+const float SEND_PRIORITY_FALLOFF = 200.0f;
+
+// The food stream has no send priority of its own, so up to 1/FOOD_BUDGET_SHARE
+// of the budget is held back for it while players are written
+const size_t FOOD_BUDGET_SHARE = 4;
+
+// Smallest budget that still carries the largest food event: the snapshot
+// header, empty entity, removal and player sections, the food checksum, and
+// the food event section with its first event number. Below this the food
+// stream could stall for good behind one big CHUNK_STATE.
+const size_t MIN_SNAPSHOT_BUDGET = MESSAGE_HEADER_SIZE + 20 + 3 * SECTION_HEADER_SIZE +
+    SECTION_HEADER_SIZE + 12 + SECTION_HEADER_SIZE + 4 + (MAX_FOOD_EVENT_BITS + 7) / 8;
+
+// Grid positions and a size code, as quantizePosition and quantizeSize produce
+struct SnapshotCell {
+    int32_t x;
+    int32_t y;
+    uint16_t size;
+};
+
+struct SnapshotPlayer {
+    uint16_t id;         // Entity id on this connection
+    uint32_t firstCell;  // Index into SnapshotState::cells
+    uint8_t cellCount;
+};
+
+struct SnapshotLeader {
+    uint16_t id;  // Entity id on this connection
+    float totalSize;
+
+    bool operator==(const SnapshotLeader& other) const {
+        return id == other.id && totalSize == other.totalSize;
+    }
+};
+
+// Metadata for one entity id, sent until the client acknowledges it
+struct EntityInfo {
+    uint16_t id;
+    uint32_t playerId;  // Server-wide player id, as in MSG_WELCOME
+    uint8_t r, g, b;
+    std::string name;
+};
+
+struct SnapshotState {
+    SnapshotHeader header = {};  // header.sequence 0 marks an empty ring slot
+    std::vector<SnapshotPlayer> players;  // Sorted by id
+    std::vector<SnapshotCell> cells;
+    std::vector<SnapshotLeader> leaderboard;
+    uint32_t foodThrough = 0;  // Server side: food events numbered below this were carried
+
+    int32_t originX() const {
+        return quantizePosition(header.x);
+    }
+
+    int32_t originY() const {
+        return quantizePosition(header.y);
+    }
+
+    // Keeps capacity, so refilling a ring slot does not reallocate
+    void clear() {
+        header = SnapshotHeader();
+        players.clear();
+        cells.clear();
+        leaderboard.clear();
+        foodThrough = 0;
+    }
+
+    void addPlayer(const SnapshotPlayer& player, const SnapshotCell* playerCells) {
+        players.push_back(player);
+        players.back().firstCell = (uint32_t)cells.size();
+        cells.insert(cells.end(), playerCells, playerCells + player.cellCount);
+    }
+
+    const SnapshotCell* cellsOf(const SnapshotPlayer& player) const {
+        return cells.data() + player.firstCell;
+    }
+};
+
+inline bool sameCell(const SnapshotCell& a, const SnapshotCell& b) {
+    return a.x == b.x && a.y == b.y && a.size == b.size;
+}
+
+inline uint8_t playerChanges(const SnapshotState& baseline, const SnapshotPlayer& before,
+    const SnapshotState& current, const SnapshotPlayer& after) {
+    if (before.cellCount != after.cellCount) return PLAYER_CELLS;
+
+    const SnapshotCell* oldCells = baseline.cellsOf(before);
+    const SnapshotCell* newCells = current.cellsOf(after);
+    for (int i = 0; i < after.cellCount; i++) {
+        if (!sameCell(oldCells[i], newCells[i])) return PLAYER_CELL_DELTA;
+    }
+    return 0;
+}
+
+inline const SnapshotPlayer* findPlayer(const SnapshotState& state, uint16_t id) {
+    auto it = std::lower_bound(state.players.begin(), state.players.end(), id,
+        [](const SnapshotPlayer& player, uint16_t value) { return player.id < value; });
+    return (it != state.players.end() && it->id == id) ? &*it : nullptr;
+}
+
+inline int64_t distanceSquared(int32_t x, int32_t y, int32_t originX, int32_t originY) {
+    int64_t dx = x - originX;
+    int64_t dy = y - originY;
+    return dx * dx + dy * dy;
+}
+
+// Squared grid distance from the origin to the player's nearest cell
+inline int64_t playerDistance(const SnapshotState& state, const SnapshotPlayer& player) {
+    int64_t nearest = INT64_MAX;
+    const SnapshotCell* cells = state.cellsOf(player);
+    for (int i = 0; i < player.cellCount; i++) {
+        int64_t distance = distanceSquared(cells[i].x, cells[i].y, state.originX(), state.originY());
+        if (distance < nearest) nearest = distance;
+    }
+    return nearest;
+}
+
+// How much a changed player's send priority grows per snapshot it waits
+inline float sendWeight(const SnapshotState& state, const SnapshotPlayer& player) {
+    uint16_t largest = 0;
+    const SnapshotCell* cells = state.cellsOf(player);
+    for (int i = 0; i < player.cellCount; i++) largest = std::max(largest, cells[i].size);
+    float distance = std::sqrt((float)playerDistance(state, player)) * POSITION_STEP;
+    return std::sqrt(dequantizeSize(largest)) * SEND_PRIORITY_FALLOFF / (SEND_PRIORITY_FALLOFF + distance);
+}
+
+inline void writeEntityInfo(ByteWriter& writer, const EntityInfo& info) {
+    writer.writeU16(info.id);
+    writer.writeU32(info.playerId);
+    writer.writeU8(info.r);
+    writer.writeU8(info.g);
+    writer.writeU8(info.b);
+    writer.writeString(info.name);
+}
+
+inline bool readEntityInfo(ByteReader& reader, EntityInfo& info) {
+    info.id = reader.readU16();
+    info.playerId = reader.readU32();
+    info.r = reader.readU8();
+    info.g = reader.readU8();
+    info.b = reader.readU8();
+    ByteString name = reader.readString();
+    if (reader.failed) return false;
+    info.name.assign(name.data, name.length);
+    return true;
+}
+
+inline void writePlayerRecord(BitWriter& bits, uint8_t flags, const SnapshotPlayer& player,
+    const SnapshotCell* cells, const SnapshotCell* baselineCells, int32_t originX, int32_t originY) {
+    bits.write(player.id, ENTITY_ID_BITS);
+    bits.write(flags, PLAYER_FLAG_BITS);
+
+    if (flags & PLAYER_CELLS) {
+        bits.write(player.cellCount, CELL_COUNT_BITS);
+        for (int i = 0; i < player.cellCount; i++) {
+            bits.writeSigned(cells[i].x - originX, POSITION_BITS);
+            bits.writeSigned(cells[i].y - originY, POSITION_BITS);
+            bits.write(cells[i].size, SIZE_BITS);
+        }
+    }
+    else if (flags & PLAYER_CELL_DELTA) {
+        for (int i = 0; i < player.cellCount; i++) {
+            uint8_t mask = 0;
+            if (cells[i].x != baselineCells[i].x) mask |= CELL_X;
+            if (cells[i].y != baselineCells[i].y) mask |= CELL_Y;
+            if (cells[i].size != baselineCells[i].size) mask |= CELL_SIZE;
+            bits.write(mask, CELL_MASK_BITS);
+            if (mask & CELL_X) bits.writeSigned(cells[i].x - originX, POSITION_BITS);
+            if (mask & CELL_Y) bits.writeSigned(cells[i].y - originY, POSITION_BITS);
+            if (mask & CELL_SIZE) bits.write(cells[i].size, SIZE_BITS);
+        }
+    }
+}
+
+// Rewinds a record that did not fit; returns false once the packet is full
+inline bool commitRecord(ByteWriter& writer, size_t mark) {
+    if (!writer.overflow) return true;
+    writer.length = mark;
+    writer.overflow = false;
+    return false;
+}
+
+// Also keeps room for the byte that flush will still write
+inline bool commitRecord(BitWriter& bits, const BitWriter::Mark& mark) {
+    ByteWriter& bytes = bits.bytes;
+    if (!bytes.overflow && (bits.pendingBits == 0 || bytes.length < bytes.capacity)) return true;
+    bits.rewind(mark);
+    return false;
+}
+
+// Bytes of the budget to hold back for the food stream: what the checksum and
+// the pending events need, up to budget / FOOD_BUDGET_SHARE, but always the
+// checksum and the oldest event, so one large CHUNK_STATE cannot wait forever
+// behind a crowded view
+inline size_t foodReserve(const FoodSync& food, bool checksumDue, size_t budget) {
+    size_t reserve = checksumDue ? SECTION_HEADER_SIZE + 12 : 0;
+    if (food.events.empty()) return reserve;
+    reserve += SECTION_HEADER_SIZE + 4;
+    size_t share = std::max(budget / FOOD_BUDGET_SHARE, reserve + (foodEventBits(food.events.front()) + 7) / 8);
+    size_t bits = 0;
+    for (const FoodEvent& event : food.events) {
+        bits += foodEventBits(event);
+        if (reserve + (bits + 7) / 8 >= share) return share;
+    }
+    return reserve + (bits + 7) / 8;
+}
+
+// Encodes current against baseline (nullptr for a full snapshot) as a
+// MSG_SNAPSHOT, followed by as much of the food stream as fits. Records that
+// do not fit are left out, and sent receives exactly the state the client
+// will rebuild, so it can serve as a later baseline. announcements and player
+// removals go first and are never left out; everything after them stops at
+// budget bytes, narrowing the writer to it. Players may not use the part of
+// the budget held back for food (see foodReserve). priority is indexed by entity id
+// and must cover every player in current. chunks is the server's seeded food,
+// which chunk state events are written from. Returns the datagram length, or
+// 0 if the header and announcements did not fit.
+inline size_t encodeSnapshotDelta(ByteWriter& writer, const SnapshotState* baseline,
+    const SnapshotState& current, const std::vector<EntityInfo>& announcements, std::vector<float>& priority,
+    FoodSync& food, const std::vector<FoodChunk>& chunks, size_t budget, SnapshotState& sent) {
+    static const SnapshotState empty;
+    const SnapshotState& base = baseline ? *baseline : empty;
+
+    sent.clear();
+    sent.header = current.header;
+    sent.header.sequence = 0;  // Set once the message is complete
+
+    beginMessage(writer, MSG_SNAPSHOT);
+    writer.writeU32(current.header.sequence);
+    writer.writeU32(baseline ? baseline->header.sequence : 0);
+    writer.writeF32(current.header.x);
+    writer.writeF32(current.header.y);
+    writer.writeF32(current.header.size);
+
+    size_t section = beginSection(writer, SECTION_ENTITIES);
+    for (const EntityInfo& info : announcements) writeEntityInfo(writer, info);
+    endSection(writer, section, (uint16_t)announcements.size());
+    if (writer.overflow) return 0;
+
+    // Removals are a few bytes each and go next, so they always fit
+    section = beginSection(writer, SECTION_PLAYERS_REMOVED);
+    uint16_t count = 0;
+    size_t j = 0;
+    for (const SnapshotPlayer& before : base.players) {
+        while (j < current.players.size() && current.players[j].id < before.id) j++;
+        if (j < current.players.size() && current.players[j].id == before.id) continue;
+        writer.writeU16(before.id);
+        count++;
+    }
+    endSection(writer, section, count);
+    if (writer.overflow) return 0;
+    writer.capacity = std::min(writer.capacity, std::max(budget, writer.length));
+    size_t fullCapacity = writer.capacity;
+    bool checksumDue = current.header.sequence % FOOD_CHECKSUM_INTERVAL == 0;
+    size_t reserve = foodReserve(food, checksumDue, budget);
+    writer.capacity = std::max(writer.length, (fullCapacity > reserve) ? fullCapacity - reserve : 0);
+
+    bool room = true;
+    if (!(current.leaderboard == base.leaderboard)) {
+        size_t mark = writer.length;
+        section = beginSection(writer, SECTION_LEADERBOARD);
+        for (const SnapshotLeader& leader : current.leaderboard) {
+            writeLeaderboardEntry(writer, leader.id, leader.totalSize);
+        }
+        endSection(writer, section, (uint16_t)current.leaderboard.size());
+        // One that does not fit waits for a snapshot with fewer changes, and
+        // leaves the room to the players
+        sent.leaderboard = commitRecord(writer, mark) ? current.leaderboard : base.leaderboard;
+    }
+    else {
+        sent.leaderboard = base.leaderboard;
+    }
+
+    // Changed players go highest send priority first, so when the budget runs
+    // out it is the ones that waited least for the least reason that wait
+    // again, and when the snapshot is split into fragments the viewer's
+    // surroundings mostly lead the first one. A player the client is in sync
+    // with starts over from 0.
+    // Each section body is one bit stream, padded to a whole byte at the end.
+    // Scratch is per thread: the server encodes snapshots on several at once
+    static thread_local std::vector<std::pair<float, uint32_t>> order;
+    static thread_local std::vector<uint8_t> changes;
+    static thread_local std::vector<uint8_t> inSync;
+    int32_t originX = current.originX();
+    int32_t originY = current.originY();
+    BitWriter bits(writer);
+    size_t mark = writer.length;
+    section = beginSection(writer, SECTION_PLAYERS);
+    if (!commitRecord(writer, mark)) room = false;
+
+    order.clear();
+    changes.resize(current.players.size());
+    for (size_t i = 0; i < current.players.size(); i++) {
+        const SnapshotPlayer& after = current.players[i];
+        const SnapshotPlayer* before = findPlayer(base, after.id);
+        changes[i] = before ? playerChanges(base, *before, current, after) : PLAYER_CELLS;
+        if (changes[i] == 0) {
+            priority[after.id] = 0.0f;
+            continue;
+        }
+        priority[after.id] += sendWeight(current, after);
+        order.push_back({ -priority[after.id], (uint32_t)i });
+    }
+    std::sort(order.begin(), order.end());
+    inSync.assign(current.players.size(), 1);
+    count = 0;
+    for (const auto& next : order) {
+        const SnapshotPlayer& after = current.players[next.second];
+        const SnapshotPlayer* before = findPlayer(base, after.id);
+        uint8_t flags = changes[next.second];
+        if (room) {
+            BitWriter::Mark recordMark = bits.mark();
+            writePlayerRecord(bits, flags, after, current.cellsOf(after), before ? base.cellsOf(*before) : nullptr,
+                originX, originY);
+            room = commitRecord(bits, recordMark);
+        }
+        if (room) {
+            count++;
+            priority[after.id] = 0.0f;
+        }
+        inSync[next.second] = room;
+    }
+    bits.flush();
+    endSection(writer, section, count);
+    writer.capacity = fullCapacity;  // Food also gets whatever the players left
+
+    for (size_t i = 0; i < current.players.size(); i++) {
+        const SnapshotPlayer& after = current.players[i];
+        const SnapshotPlayer* before = inSync[i] ? nullptr : findPlayer(base, after.id);
+        if (inSync[i]) sent.addPlayer(after, current.cellsOf(after));
+        else if (before) sent.addPlayer(*before, base.cellsOf(*before));
+    }
+
+    // Food events in stream order, from the oldest the client has not
+    // acknowledged; the first that does not fit ends the section. New dots are
+    // queued nearest first, so here too the far edge is what waits.
+    sent.foodThrough = food.firstEvent;
+    if (checksumDue) {
+        FoodChecksum checksum = food.checksum();
+        mark = writer.length;
+        section = beginSection(writer, SECTION_FOOD_CHECKSUM);
+        writer.writeU32(checksum.through);
+        writer.writeU32(checksum.count);
+        writer.writeU32(checksum.hash);
+        endSection(writer, section, 1);
+        commitRecord(writer, mark);
+    }
+
+    if (!food.events.empty()) {
+        mark = writer.length;
+        section = beginSection(writer, SECTION_FOOD_EVENTS);
+        writer.writeU32(food.firstEvent);
+        if (commitRecord(writer, mark)) {
+            count = 0;
+            for (const FoodEvent& event : food.events) {
+                if (!foodEventFits(event, chunks, originX, originY)) {
+                    // Queued before a long jump or a regrowth; start the stream over from the new view
+                    food.resyncRequested = true;
+                    break;
+                }
+                BitWriter::Mark recordMark = bits.mark();
+                writeFoodEvent(bits, event, chunks, originX, originY);
+                if (!commitRecord(bits, recordMark)) break;
+                count++;
+            }
+            bits.flush();
+            endSection(writer, section, count);
+            sent.foodThrough = food.firstEvent + count;
+        }
+    }
+
+    size_t length = finishMessage(writer);
+    if (length > 0) sent.header.sequence = current.header.sequence;
+    return length;
+}
+
+// Reads the sequence and baseline sequence at the start of a MSG_SNAPSHOT payload
+inline bool peekSnapshotSequence(const ByteReader& reader, uint32_t& sequence, uint32_t& baseline) {
+    ByteReader peek = reader;
+    sequence = peek.readU32();
+    baseline = peek.readU32();
+    return !peek.failed;
+}
+
+inline bool readPlayerRecord(BitReader& bits, const SnapshotState& base, const SnapshotPlayer* before,
+    int32_t originX, int32_t originY, SnapshotState& out) {
+    SnapshotPlayer player = {};
+    player.id = (uint16_t)bits.read(ENTITY_ID_BITS);
+    uint8_t flags = (uint8_t)bits.read(PLAYER_FLAG_BITS);
+    if (bits.failed()) return false;
+
+    if (before) player.cellCount = before->cellCount;
+    else if (!(flags & PLAYER_CELLS)) return false;  // A new player must arrive complete
+
+    SnapshotCell cells[255];
+    if (flags & PLAYER_CELLS) {
+        player.cellCount = (uint8_t)bits.read(CELL_COUNT_BITS);
+        for (int i = 0; i < player.cellCount; i++) {
+            cells[i].x = originX + bits.readSigned(POSITION_BITS);
+            cells[i].y = originY + bits.readSigned(POSITION_BITS);
+            cells[i].size = (uint16_t)bits.read(SIZE_BITS);
+        }
+    }
+    else {
+        const SnapshotCell* baselineCells = base.cellsOf(*before);
+        for (int i = 0; i < player.cellCount; i++) {
+            cells[i] = baselineCells[i];
+            if (!(flags & PLAYER_CELL_DELTA)) continue;
+            uint32_t mask = bits.read(CELL_MASK_BITS);
+            if (mask & CELL_X) cells[i].x = originX + bits.readSigned(POSITION_BITS);
+            if (mask & CELL_Y) cells[i].y = originY + bits.readSigned(POSITION_BITS);
+            if (mask & CELL_SIZE) cells[i].size = (uint16_t)bits.read(SIZE_BITS);
+        }
+    }
+
+    if (bits.failed()) return false;
+    out.addPlayer(player, cells);
+    return true;
+}
+
+inline bool containsId(ByteReader removed, uint16_t count, uint16_t id) {
+    for (int i = 0; i < count; i++) {
+        if (removed.readU16() == id) return true;
+    }
+    return false;
+}
+
+// Rebuilds the full state of a MSG_SNAPSHOT payload into out, its entity
+// announcements into announced and the food events it carried into food.
+// baseline must be the state named by the snapshot's baseline sequence
+// (nullptr when that is 0).
+inline bool decodeSnapshotDelta(ByteReader& reader, const SnapshotState* baseline, SnapshotState& out,
+    std::vector<EntityInfo>& announced, FoodUpdate& food) {
+    static const SnapshotState empty;
+    const SnapshotState& base = baseline ? *baseline : empty;
+
+    out.clear();
+    out.header.sequence = reader.readU32();
+    reader.readU32();  // Baseline sequence, already matched by the caller
+    out.header.x = reader.readF32();
+    out.header.y = reader.readF32();
+    out.header.size = reader.readF32();
+    if (reader.failed) return false;
+
+    Section removedPlayers, players, foodEvents, leaderboard;
+    bool hasLeaderboard = false;
+    Section section;
+    announced.clear();
+    food.clear();
+    while (readSection(reader, section)) {
+        if (section.tag == SECTION_ENTITIES) {
+            announced.resize(section.count);
+            for (int i = 0; i < section.count; i++) {
+                if (!readEntityInfo(section.body, announced[i])) return false;
+            }
+        }
+        else if (section.tag == SECTION_PLAYERS_REMOVED) removedPlayers = section;
+        else if (section.tag == SECTION_PLAYERS) players = section;
+        else if (section.tag == SECTION_FOOD_EVENTS) foodEvents = section;
+        else if (section.tag == SECTION_FOOD_CHECKSUM) {
+            food.checksum.through = section.body.readU32();
+            food.checksum.count = section.body.readU32();
+            food.checksum.hash = section.body.readU32();
+            if (section.body.failed) return false;
+            food.hasChecksum = true;
+        }
+        else if (section.tag == SECTION_LEADERBOARD) {
+            leaderboard = section;
+            hasLeaderboard = true;
+        }
+    }
+
+    // Players: change records arrive nearest first. Apply each to its baseline
+    // entry, then merge the results with the untouched baseline entries by id.
+    static thread_local SnapshotState changed;
+    changed.clear();
+    int32_t originX = out.originX();
+    int32_t originY = out.originY();
+    BitReader playerBits(players.body);
+    for (int i = 0; i < players.count; i++) {
+        uint16_t id = (uint16_t)BitReader(playerBits).read(ENTITY_ID_BITS);
+        if (!readPlayerRecord(playerBits, base, findPlayer(base, id), originX, originY, changed)) return false;
+    }
+    std::sort(changed.players.begin(), changed.players.end(),
+        [](const SnapshotPlayer& a, const SnapshotPlayer& b) { return a.id < b.id; });
+
+    size_t next = 0;
+    for (const SnapshotPlayer& before : base.players) {
+        for (; next < changed.players.size() && changed.players[next].id < before.id; next++) {
+            out.addPlayer(changed.players[next], changed.cellsOf(changed.players[next]));
+        }
+
+        if (next < changed.players.size() && changed.players[next].id == before.id) {
+            out.addPlayer(changed.players[next], changed.cellsOf(changed.players[next]));
+            next++;
+        }
+        else if (!containsId(removedPlayers.body, removedPlayers.count, before.id)) {
+            out.addPlayer(before, base.cellsOf(before));
+        }
+    }
+    for (; next < changed.players.size(); next++) {
+        out.addPlayer(changed.players[next], changed.cellsOf(changed.players[next]));
+    }
+
+    if (foodEvents.count > 0) {
+        food.first = foodEvents.body.readU32();
+        food.events.resize(foodEvents.count);
+        BitReader foodBits(foodEvents.body);
+        for (int i = 0; i < foodEvents.count; i++) {
+            if (!readFoodEvent(foodBits, food.events[i], food.eaten, originX, originY)) return false;
+        }
+    }
+
+    if (hasLeaderboard) {
+        for (int i = 0; i < leaderboard.count; i++) {
+            LeaderboardEntry entry;
+            if (!readLeaderboardEntry(leaderboard.body, entry)) return false;
+            out.leaderboard.push_back({ entry.id, entry.totalSize });
+        }
+    }
+    else {
+        out.leaderboard = base.leaderboard;
+    }
+    return true;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include "food_kernels.h"
+
+// Uniform bucket grid over the map. Stores the owner's slot numbers with their
+// positions so queries only touch the buckets a circle or rectangle overlaps.
+// Buckets are kept as structure-of-arrays so circle queries run through the
+// SIMD distance kernels. The grid keeps no index of its own: insert returns
+// where an entry landed and the owner hands that location back to remove it.
+struct SpatialGrid {
+    struct Entry {
+        int slot;
+        float x;
+        float y;
+    };
+
+    struct Bucket {
+        std::vector<int> slots;
+        std::vector<float> xs;
+        std::vector<float> ys;
+    };
+
+    struct Location {
+        int bucket;
+        int index;
+    };
+
+    static const int MAX_COLUMNS = 512;
+    static const int QUERY_BLOCK = 256;
+
+    float cellSize = 1.0f;
+    int columns = 1;
+    int rows = 1;
+    std::vector<Bucket> buckets;
+
+    void init(float width, float height, float desiredCellSize) {
+        cellSize = desiredCellSize;
+        if (cellSize < 1.0f) cellSize = 1.0f;
+
+        // Keep the bucket count bounded on very large maps
+        float largest = (width > height) ? width : height;
+        if (largest / cellSize > MAX_COLUMNS) cellSize = largest / MAX_COLUMNS;
+
+        columns = (int)std::ceil(width / cellSize);
+        rows = (int)std::ceil(height / cellSize);
+        if (columns < 1) columns = 1;
+        if (rows < 1) rows = 1;
+
+        buckets.clear();
+        buckets.resize((size_t)columns * rows);
+    }
+
+    int columnFor(float x) const {
+        int col = (int)(x / cellSize);
+        if (col < 0) return 0;
+        if (col >= columns) return columns - 1;
+        return col;
+    }
+
+    int rowFor(float y) const {
+        int row = (int)(y / cellSize);
+        if (row < 0) return 0;
+        if (row >= rows) return rows - 1;
+        return row;
+    }
+
+    Location insert(int slot, float x, float y) {
+        int bucket = rowFor(y) * columns + columnFor(x);
+        Bucket& entries = buckets[bucket];
+        Location location = { bucket, (int)entries.slots.size() };
+        entries.slots.push_back(slot);
+        entries.xs.push_back(x);
+        entries.ys.push_back(y);
+        return location;
+    }
+
+    // Removes the entry at location by moving its bucket's last entry into the
+    // hole. Returns the moved entry's slot, whose location is now this one, or -1.
+    int remove(Location location) {
+        Bucket& entries = buckets[location.bucket];
+        int moved = -1;
+        if (location.index != (int)entries.slots.size() - 1) {
+            moved = entries.slots.back();
+            entries.slots[location.index] = moved;
+            entries.xs[location.index] = entries.xs.back();
+            entries.ys[location.index] = entries.ys.back();
+        }
+        entries.slots.pop_back();
+        entries.xs.pop_back();
+        entries.ys.pop_back();
+        return moved;
+    }
+
+    // Renumbers the entry at location after its owner moved it to another slot
+    void setSlot(Location location, int slot) {
+        buckets[location.bucket].slots[location.index] = slot;
+    }
+
+    float xAt(Location location) const {
+        return buckets[location.bucket].xs[location.index];
+    }
+
+    float yAt(Location location) const {
+        return buckets[location.bucket].ys[location.index];
+    }
+
+    // Calls fn(entry) for every entry inside the rectangle; fn returns false to stop early
+    template<typename Fn>
+    void queryRect(float minX, float minY, float maxX, float maxY, Fn fn) const {
+        int firstCol = columnFor(minX);
+        int lastCol = columnFor(maxX);
+        int firstRow = rowFor(minY);
+        int lastRow = rowFor(maxY);
+
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int col = firstCol; col <= lastCol; col++) {
+                const Bucket& bucket = buckets[row * columns + col];
+                for (size_t i = 0; i < bucket.slots.size(); i++) {
+                    Entry entry = { bucket.slots[i], bucket.xs[i], bucket.ys[i] };
+                    if (entry.x < minX || entry.x > maxX || entry.y < minY || entry.y > maxY) continue;
+                    if (!fn(entry)) return;
+                }
+            }
+        }
+    }
+
+    // Calls fn(entry) for every entry strictly within radius of (x, y); fn returns false to stop early
+    template<typename Fn>
+    void queryCircle(float x, float y, float radius, Fn fn) const {
+        float radiusSq = radius * radius;
+        int firstCol = columnFor(x - radius);
+        int lastCol = columnFor(x + radius);
+        int firstRow = rowFor(y - radius);
+        int lastRow = rowFor(y + radius);
+        int hits[QUERY_BLOCK];
+
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int col = firstCol; col <= lastCol; col++) {
+                const Bucket& bucket = buckets[row * columns + col];
+                int count = (int)bucket.slots.size();
+
+                for (int start = 0; start < count; start += QUERY_BLOCK) {
+                    int blockSize = (count - start < QUERY_BLOCK) ? count - start : QUERY_BLOCK;
+                    int found = withinRadius(bucket.xs.data() + start, bucket.ys.data() + start,
+                        blockSize, x, y, radiusSq, hits);
+
+                    for (int k = 0; k < found; k++) {
+                        int i = start + hits[k];
+                        Entry entry = { bucket.slots[i], bucket.xs[i], bucket.ys[i] };
+                        if (!fn(entry)) return;
+                    }
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Hierarchical timer wheel for deadlines measured in whole ticks. Level 0 has
+// one slot per tick; each level above has slots TIMER_SLOTS times wider, and
+// its entries drop a level whenever the wheel below comes round to them.
+// Scheduling is O(1) and advancing only touches timers that come due, plus
+// the occasional cascade, however many timers are pending.
+//
+// Timers cannot be cancelled. Owners check on expiry whether the timer still
+// means anything (the player may be gone, or active again) and schedule a
+// new one if needed.
+const int TIMER_SLOT_BITS = 6;
+const int TIMER_SLOTS = 1 << TIMER_SLOT_BITS;
+const int TIMER_LEVELS = 4;  // 64^4 ticks ahead before deadlines get clamped
+
+struct TimerWheel {
+    struct Timer {
+        uint32_t key;   // What the timer is for, e.g. a player handle
+        uint8_t kind;   // Which of the owner's timers this is
+        uint64_t dueTick;
+    };
+
+    std::vector<Timer> slots[TIMER_LEVELS][TIMER_SLOTS];
+    uint64_t currentTick = 0;
+    size_t pending = 0;
+
+    void init(uint64_t tick) {
+        for (auto& level : slots) {
+            for (auto& slot : level) slot.clear();
+        }
+        currentTick = tick;
+        pending = 0;
+    }
+
+    // Due ticks already passed fire on the next advance
+    void schedule(uint32_t key, uint8_t kind, uint64_t dueTick) {
+        if (dueTick <= currentTick) dueTick = currentTick + 1;
+        place({ key, kind, dueTick });
+        pending++;
+    }
+
+    // The first tick advance has work on: a timer coming due, or an upper
+    // level slot coming down, which is never later than the timers in it.
+    // UINT64_MAX when nothing is pending.
+    uint64_t nextDueTick() const {
+        if (pending == 0) return UINT64_MAX;
+        uint64_t next = UINT64_MAX;
+        for (uint64_t tick = currentTick + 1; tick <= currentTick + TIMER_SLOTS; tick++) {
+            if (slots[0][tick & (TIMER_SLOTS - 1)].empty()) continue;
+            next = tick;
+            break;
+        }
+        for (int level = 1; level < TIMER_LEVELS; level++) {
+            int shift = TIMER_SLOT_BITS * level;
+            uint64_t position = currentTick >> shift;
+            for (uint64_t ahead = position + 1; ahead <= position + TIMER_SLOTS; ahead++) {
+                if (slots[level][ahead & (TIMER_SLOTS - 1)].empty()) continue;
+                if ((ahead << shift) < next) next = ahead << shift;
+                break;
+            }
+        }
+        return next;
+    }
+
+    // Steps the wheel up to tick, calling fire(key, kind) for every timer
+    // that came due on the way. fire may schedule new timers.
+    template<typename Fire>
+    void advance(uint64_t tick, Fire fire) {
+        static std::vector<Timer> due;
+        while (currentTick < tick) {
+            currentTick++;
+            cascade(1);
+
+            std::vector<Timer>& slot = slots[0][currentTick & (TIMER_SLOTS - 1)];
+            if (slot.empty()) continue;
+            due.swap(slot);
+            pending -= due.size();
+            for (const Timer& timer : due) fire(timer.key, timer.kind);
+            due.clear();
+        }
+    }
+
+    void place(const Timer& timer) {
+        uint64_t delta = timer.dueTick - currentTick;
+        int level = 0;
+        while (level < TIMER_LEVELS - 1 && delta >= (1ull << (TIMER_SLOT_BITS * (level + 1)))) level++;
+
+        uint64_t dueTick = timer.dueTick;
+        uint64_t span = 1ull << (TIMER_SLOT_BITS * (level + 1));
+        if (delta >= span) dueTick = currentTick + span - 1;  // Beyond the top level: re-placed when reached
+        size_t index = (size_t)(dueTick >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1);
+        slots[level][index].push_back(timer);
+    }
+
+    // Moves the entries of each upper level's current slot down a level, from
+    // the top, whenever the levels below have just wrapped round
+    void cascade(int level) {
+        if (level >= TIMER_LEVELS) return;
+        uint64_t below = currentTick >> (TIMER_SLOT_BITS * (level - 1));
+        if (below & (TIMER_SLOTS - 1)) return;
+        cascade(level + 1);
+
+        static std::vector<Timer> moving;
+        std::vector<Timer>& slot = slots[level][(currentTick >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1)];
+        if (slot.empty()) return;
+        moving.swap(slot);
+        for (const Timer& timer : moving) place(timer);
+        moving.clear();
+    }
+};
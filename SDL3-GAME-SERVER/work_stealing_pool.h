@@ -0,0 +1,148 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Fork-join thread pool with work stealing. run(jobCount, fn) calls
+// fn(job, worker) once for every job in [0, jobCount) and returns when all of
+// them are done; the calling thread works too, as worker 0. Jobs are dealt
+// round-robin onto one queue per worker. A worker takes from the back of its
+// own queue and, once that is empty, steals from the front of the others, so
+// one crowded job does not leave the rest of its thread's share waiting.
+//
+// Which worker runs which job varies from run to run; jobs must not depend on it
+// for anything but picking their scratch space.
+struct WorkStealingPool {
+    struct Queue {
+        std::mutex lock;
+        std::vector<int> jobs;
+        size_t head = 0;  // Thieves take from here
+        size_t tail = 0;  // The owner takes from here
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    uint64_t generation = 0;  // Bumped under wakeLock for every run
+    bool stopping = false;
+    std::atomic<int> remaining{ 0 };
+    void (*invoke)(void* context, int job, int worker) = nullptr;
+    void* context = nullptr;
+
+    ~WorkStealingPool() {
+        stop();
+    }
+
+    // Starts workerCount - 1 threads; the thread calling run is the last worker
+    void start(int workerCount) {
+        stop();
+        if (workerCount < 1) workerCount = 1;
+        stopping = false;
+        queues.clear();
+        for (int i = 0; i < workerCount; i++) queues.emplace_back(new Queue());
+        for (int i = 1; i < workerCount; i++) {
+            threads.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) thread.join();
+        threads.clear();
+    }
+
+    int workerCount() const {
+        return queues.empty() ? 1 : (int)queues.size();
+    }
+
+    template<typename Fn>
+    void run(int jobCount, Fn fn) {
+        if (jobCount <= 0) return;
+        if (queues.size() <= 1) {
+            for (int job = 0; job < jobCount; job++) fn(job, 0);
+            return;
+        }
+
+        // Published before the jobs are, so a worker still looking for work
+        // from the last run may pick these up early without harm
+        invoke = [](void* context, int job, int worker) { (*(Fn*)context)(job, worker); };
+        context = &fn;
+        remaining.store(jobCount);
+
+        int workers = (int)queues.size();
+        for (int w = 0; w < workers; w++) {
+            Queue& queue = *queues[w];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.jobs.clear();
+            for (int job = w; job < jobCount; job += workers) queue.jobs.push_back(job);
+            queue.head = 0;
+            queue.tail = queue.jobs.size();
+        }
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            generation++;
+        }
+        wake.notify_all();
+
+        work(0);
+        std::unique_lock<std::mutex> guard(wakeLock);
+        finished.wait(guard, [this] { return remaining.load() == 0; });
+    }
+
+    void workerLoop(int worker) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(wakeLock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            work(worker);
+        }
+    }
+
+    // Runs jobs until there are none left to take or steal
+    void work(int worker) {
+        int job;
+        while (take(worker, job)) {
+            invoke(context, job, worker);
+            if (remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> guard(wakeLock);
+                finished.notify_all();
+            }
+        }
+    }
+
+    bool take(int worker, int& job) {
+        int workers = (int)queues.size();
+        {
+            Queue& own = *queues[worker];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (own.head < own.tail) {
+                job = own.jobs[--own.tail];
+                return true;
+            }
+        }
+        for (int i = 1; i < workers; i++) {
+            Queue& victim = *queues[(worker + i) % workers];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (victim.head < victim.tail) {
+                job = victim.jobs[victim.head++];
+                return true;
+            }
+        }
+        return false;
+    }
+};